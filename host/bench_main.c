@@ -0,0 +1,46 @@
+/********************************
+ * bench_main.c
+ *
+ *  Runs src/bench.c against the lcd_sim.c model, so the
+ *  budgets in _cases can be checked without a board.
+ *  Times are model bus time, the CPU is free here.
+ *
+ *  make -C host bench
+ *
+ ********************************/
+
+/********************************
+ * Includes
+ ********************************/
+#include <driverlib.h>
+#include "driverlib_stub.h"
+#include "lcd_sim.h"
+#include "bench.h"
+
+/********************************
+ * Global variables specific to file
+ ********************************/
+#define MCLK_HZ             3000000     // MSP432 reset clocks
+#define SMCLK_HZ            3000000
+#define SLAVE_ADDRESS       0x27
+
+static SIM_Lcd _sim;
+static LCD_Object _lcd;
+
+/********************************
+ * Exits with the number of results over budget
+ ********************************/
+int main(void)
+{
+    STUB_reset(MCLK_HZ, SMCLK_HZ);
+    SIM_init(&_sim, LCD_I2C_STANDARD);
+    STUB_attach(EUSCI_B0_BASE, SLAVE_ADDRESS, &_sim);
+
+    Interrupt_registerInterrupt(INT_EUSCIB0, LCD_i2cB0IntHandler);
+    Interrupt_registerInterrupt(INT_DMA_INT1, LCD_dmaB0IntHandler);
+    Interrupt_registerInterrupt(INT_T32_INT2, LCD_timerIntHandler);
+
+    int failures = BENCH_run(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS);
+
+    return (_sim.violations || failures) ? 1 : 0;
+}
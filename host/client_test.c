@@ -0,0 +1,194 @@
+/********************************
+ * client_test.c
+ *
+ *  End to end test for lcd_client.c over a pty. The
+ *  master side plays the device: src/protocol.c parses
+ *  the frames and drives i2c_lcd.c on the driverlib stub,
+ *  ACKs go back the way USB_sendBuffer would send them.
+ *  The client only sees a serial port.
+ *
+ *  make -C host test
+ *
+ ********************************/
+
+/********************************
+ * Includes
+ ********************************/
+#define _DEFAULT_SOURCE
+#include <poll.h>
+#include <pthread.h>
+#include <pty.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <driverlib.h>
+#include "driverlib_stub.h"
+#include "lcd_client.h"
+#include "lcd_sim.h"
+#include "protocol.h"
+#include "usb.h"
+
+/********************************
+ * File specific functions
+ ********************************/
+static void * _device(void * arg);
+static void _check(bool ok, const char * what, int line);
+static bool _rowIs(uint8_t row, const char * text);
+
+/********************************
+ * Global variables specific to file
+ ********************************/
+#define CHECK(ok)           _check((ok), #ok, __LINE__)
+
+#define MCLK_HZ             3000000     // MSP432 reset clocks
+#define SMCLK_HZ            3000000
+#define SLAVE_ADDRESS       0x27
+#define SYNC_TIMEOUT_MS     2000
+
+static SIM_Lcd _sim;
+static LCD_Object _lcd;
+static int _deviceFd;
+static volatile bool _stop;
+static volatile bool _corruptNext;      // Flip a payload bit in the next frame
+static int _failures;
+
+/********************************/
+int main(void)
+{
+    int master;
+    int slave;
+    if(openpty(&master, &slave, NULL, NULL, NULL) != 0)
+    {
+        printf("client: no pty\n");
+        return 1;
+    }
+
+    // Frames are binary, the line discipline mustn't touch them
+    struct termios tty;
+    tcgetattr(slave, &tty);
+    cfmakeraw(&tty);
+    tcsetattr(slave, TCSANOW, &tty);
+
+    STUB_reset(MCLK_HZ, SMCLK_HZ);
+    SIM_init(&_sim, LCD_I2C_FAST);
+    STUB_attach(EUSCI_B0_BASE, SLAVE_ADDRESS, &_sim);
+    if(!LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST))
+    {
+        printf("client: LCD_init failed\n");
+        return 1;
+    }
+    PROTO_init(&_lcd);
+
+    _deviceFd = master;
+    pthread_t device;
+    pthread_create(&device, NULL, _device, NULL);
+
+    CLIENT_Lcd client;
+    CHECK(CLIENT_attach(&client, slave));
+
+    // First sync blits, 0x1B is just a character code
+    CLIENT_setText(&client, 0, 0, "Hello");
+    CLIENT_setText(&client, 1, 0, "pty \x1B test");
+    CHECK(CLIENT_sync(&client, SYNC_TIMEOUT_MS));
+
+    // One changed run is one WRITE_AT
+    uint32_t frames = client.frames;
+    CLIENT_setText(&client, 0, 6, "world");
+    CHECK(CLIENT_sync(&client, SYNC_TIMEOUT_MS));
+    CHECK(client.frames - frames == 1);
+    CHECK(client.errors == 0);
+
+    // A frame with a bad CRC is NAKed and the screen resent
+    _corruptNext = true;
+    CLIENT_setText(&client, 1, 12, "ok");
+    CHECK(CLIENT_sync(&client, SYNC_TIMEOUT_MS));
+    CHECK(client.errors == 1);
+
+    _stop = true;
+    pthread_join(device, NULL);
+    CLIENT_close(&client);
+    close(master);
+
+    CHECK(_rowIs(0, "Hello world     "));
+    CHECK(_rowIs(1, "pty \x1B test  ok  "));
+    CHECK(_sim.violations == 0);
+
+    if(_failures)
+    {
+        printf("client FAIL %d\n", _failures);
+        return 1;
+    }
+
+    printf("client PASS\n");
+    return 0;
+}
+
+/********************************
+ * The device's main loop: every byte from the port
+ * goes through the protocol parser
+ ********************************/
+static void * _device(void * arg)
+{
+    (void)arg;
+    uint8_t sinceSync = 0;
+
+    while(!_stop)
+    {
+        struct pollfd in = { _deviceFd, POLLIN, 0 };
+        if(poll(&in, 1, 10) <= 0)
+        {
+            continue;
+        }
+
+        uint8_t buffer[64];
+        ssize_t length = read(_deviceFd, buffer, sizeof(buffer));
+
+        ssize_t i;
+        for(i = 0; i < length; i++)
+        {
+            sinceSync = (buffer[i] == PROTO_SYNC) ? 0 : sinceSync + 1;
+
+            // Past SYNC, LEN, SEQ and OP is payload
+            if(_corruptNext && sinceSync == 4)
+            {
+                buffer[i] ^= 0x01;
+                _corruptNext = false;
+            }
+
+            PROTO_receiveChar(buffer[i]);
+        }
+    }
+
+    return NULL;
+}
+
+/********************************
+ * The device's UART, straight back down the pty
+ ********************************/
+void USB_sendBuffer(uint8_t * bufferToSend, uint8_t numChars)
+{
+    if(write(_deviceFd, bufferToSend, numChars) != numChars)
+    {
+        printf("client: device write failed\n");
+    }
+}
+
+/********************************/
+static void _check(bool ok, const char * what, int line)
+{
+    if(!ok)
+    {
+        printf("client: line %d: %s\n", line, what);
+        _failures++;
+    }
+}
+
+/********************************/
+static bool _rowIs(uint8_t row, const char * text)
+{
+    char visible[SIM_COLUMNS + 1];
+    SIM_visibleRow(&_sim, row, visible);
+
+    return strcmp(visible, text) == 0;
+}
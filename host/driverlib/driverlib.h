@@ -0,0 +1,204 @@
+/********************************
+ * driverlib.h
+ *
+ *  Stand-in for the MSP432 driverlib on a PC, just the
+ *  parts i2c_lcd.c and src/bench.c use. Names and values
+ *  follow driverlib 3.21 so they build unchanged.
+ *
+ *  Implemented in host/driverlib_stub.c, which hands the
+ *  I2C traffic to lcd_sim.c models, see driverlib_stub.h
+ *
+ ********************************/
+
+#ifndef DRIVERLIB_H_
+#define DRIVERLIB_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Code that has to know it isn't on the MSP432 can check this
+#define DRIVERLIB_STUB
+
+/********************************
+ * Interrupt numbers
+ ********************************/
+#define INT_TA0_0                       24
+#define INT_EUSCIB0                     36
+#define INT_EUSCIB1                     37
+#define INT_T32_INT1                    41
+#define INT_T32_INT2                    42
+#define INT_DMA_INT2                    48
+#define INT_DMA_INT1                    49
+#define NUM_INTERRUPTS                  64
+
+/********************************
+ * GPIO
+ ********************************/
+#define GPIO_PORT_P1                    1
+#define GPIO_PORT_P6                    6
+#define GPIO_PIN4                       0x0010
+#define GPIO_PIN5                       0x0020
+#define GPIO_PIN6                       0x0040
+#define GPIO_PIN7                       0x0080
+#define GPIO_PRIMARY_MODULE_FUNCTION    0x01
+
+/********************************
+ * EUSCI_B in I2C mode
+ ********************************/
+#define EUSCI_B0_BASE                   0x40002000
+#define EUSCI_B1_BASE                   0x40002400
+
+#define EUSCI_B_I2C_CLOCKSOURCE_SMCLK   0x80
+#define EUSCI_B_I2C_NO_AUTO_STOP        0x00
+#define EUSCI_B_I2C_TRANSMIT_MODE       0x0010
+#define EUSCI_B_I2C_RECEIVE_MODE        0x0000
+
+#define EUSCI_B_I2C_RECEIVE_INTERRUPT0  0x0001
+#define EUSCI_B_I2C_TRANSMIT_INTERRUPT0 0x0002
+#define EUSCI_B_I2C_STOP_INTERRUPT      0x0008
+#define EUSCI_B_I2C_NAK_INTERRUPT       0x0020
+
+#define EUSCI_B_CTLW0_TXSTT             0x0002
+#define EUSCI_B_CTLW0_TXSTP             0x0004
+#define EUSCI_B_CTLW0_TR                0x0010
+
+typedef struct
+{
+    uint_fast8_t selectClockSource;
+    uint32_t i2cClk;
+    uint32_t dataRate;
+    uint_fast8_t byteCounterThreshold;
+    uint_fast8_t autoSTOPGeneration;
+} eUSCI_I2C_MasterConfig;
+
+// Only the registers the driver touches directly
+typedef struct
+{
+    volatile uint16_t CTLW0;
+    volatile uint16_t TXBUF;
+} EUSCI_B_Type;
+
+EUSCI_B_Type * EUSCI_B_registers(uint32_t moduleInstance);
+#define EUSCI_B_CMSIS(x)                (EUSCI_B_registers(x))
+
+void I2C_initMaster(uint32_t moduleInstance, const eUSCI_I2C_MasterConfig * config);
+void I2C_setSlaveAddress(uint32_t moduleInstance, uint_fast16_t slaveAddress);
+void I2C_setMode(uint32_t moduleInstance, uint_fast8_t mode);
+void I2C_enableModule(uint32_t moduleInstance);
+void I2C_disableModule(uint32_t moduleInstance);
+void I2C_masterSendSingleByte(uint32_t moduleInstance, uint8_t txData);
+bool I2C_masterSendSingleByteWithTimeout(uint32_t moduleInstance, uint8_t txData, uint32_t timeout);
+void I2C_masterSendMultiByteStart(uint32_t moduleInstance, uint8_t txData);
+void I2C_masterSendMultiByteNext(uint32_t moduleInstance, uint8_t txData);
+void I2C_masterSendMultiByteFinish(uint32_t moduleInstance, uint8_t txData);
+void I2C_masterSendStart(uint32_t moduleInstance);
+uint8_t I2C_masterReceiveSingleByte(uint32_t moduleInstance);
+void I2C_enableInterrupt(uint32_t moduleInstance, uint_fast16_t mask);
+void I2C_disableInterrupt(uint32_t moduleInstance, uint_fast16_t mask);
+void I2C_clearInterruptFlag(uint32_t moduleInstance, uint_fast16_t mask);
+uint_fast16_t I2C_getInterruptStatus(uint32_t moduleInstance, uint16_t mask);
+uint_fast16_t I2C_getEnabledInterruptStatus(uint32_t moduleInstance);
+uint32_t I2C_getTransmitBufferAddressForDMA(uint32_t moduleInstance);
+
+void GPIO_setAsPeripheralModuleFunctionInputPin(uint_fast8_t selectedPort,
+        uint_fast16_t selectedPins, uint_fast8_t mode);
+
+/********************************
+ * Timer32
+ ********************************/
+#define TIMER32_0_BASE                  0x4000C000
+#define TIMER32_1_BASE                  0x4000C040
+#define TIMER32_BASE                    TIMER32_0_BASE
+
+#define TIMER32_PRESCALER_1             0x00
+#define TIMER32_32BIT                   0x02
+#define TIMER32_PERIODIC_MODE           0x40
+#define TIMER32_FREE_RUN_MODE           0x00
+
+void Timer32_initModule(uint32_t timer, uint32_t preScaler, uint32_t resolution, uint32_t mode);
+void Timer32_setCount(uint32_t timer, uint32_t count);
+void Timer32_startTimer(uint32_t timer, bool oneShot);
+uint32_t Timer32_getValue(uint32_t timer);
+void Timer32_enableInterrupt(uint32_t timer);
+void Timer32_clearInterruptFlag(uint32_t timer);
+
+/********************************
+ * Timer_A, up mode on CCR0 only
+ ********************************/
+#define TIMER_A0_BASE                       0x40000000
+
+#define TIMER_A_CLOCKSOURCE_ACLK            0x0100
+#define TIMER_A_CLOCKSOURCE_DIVIDER_1       0x01
+#define TIMER_A_TAIE_INTERRUPT_DISABLE      0x00
+#define TIMER_A_CCIE_CCR0_INTERRUPT_ENABLE  0x10
+#define TIMER_A_DO_CLEAR                    0x04
+#define TIMER_A_UP_MODE                     0x10
+#define TIMER_A_CAPTURECOMPARE_REGISTER_0   0x02
+
+typedef struct
+{
+    uint_fast16_t clockSource;
+    uint_fast16_t clockSourceDivider;
+    uint_fast16_t timerPeriod;
+    uint_fast16_t timerInterruptEnable_TAIE;
+    uint_fast16_t captureCompareInterruptEnable_CCR0_CCIE;
+    uint_fast16_t timerClear;
+} Timer_A_UpModeConfig;
+
+void Timer_A_configureUpMode(uint32_t timer, const Timer_A_UpModeConfig * config);
+void Timer_A_startCounter(uint32_t timer, uint_fast16_t timerMode);
+void Timer_A_stopTimer(uint32_t timer);
+void Timer_A_clearCaptureCompareInterrupt(uint32_t timer, uint_fast16_t captureCompareRegister);
+
+/********************************
+ * Clock system
+ ********************************/
+uint32_t CS_getMCLK(void);
+uint32_t CS_getSMCLK(void);
+uint32_t CS_getACLK(void);
+
+/********************************
+ * NVIC
+ ********************************/
+void Interrupt_registerInterrupt(uint32_t interruptNumber, void (*intHandler)(void));
+void Interrupt_enableInterrupt(uint32_t interruptNumber);
+void Interrupt_disableInterrupt(uint32_t interruptNumber);
+void Interrupt_setPriority(uint32_t interruptNumber, uint8_t priority);
+bool Interrupt_enableMaster(void);
+bool Interrupt_disableMaster(void);
+
+/********************************
+ * uDMA
+ ********************************/
+#define DMA_CH0_EUSCIB0TX0              0x01000000
+#define DMA_CH2_EUSCIB1TX0              0x01000002
+#define DMA_INT1                        INT_DMA_INT1
+#define DMA_INT2                        INT_DMA_INT2
+
+#define UDMA_PRI_SELECT                 0x00000000
+#define UDMA_SIZE_8                     0x00000000
+#define UDMA_SRC_INC_8                  0x00000000
+#define UDMA_DST_INC_NONE               0xC0000000
+#define UDMA_ARB_1                      0x00000000
+#define UDMA_MODE_BASIC                 0x00000001
+
+typedef struct
+{
+    volatile void * srcEndAddr;
+    volatile void * dstEndAddr;
+    volatile uint32_t control;
+    volatile uint32_t spare;
+} DMA_ControlTable;
+
+void DMA_enableModule(void);
+void DMA_setControlBase(void * controlTable);
+void DMA_assignChannel(uint32_t mapping);
+void DMA_setChannelControl(uint32_t channelStructIndex, uint32_t control);
+void DMA_setChannelTransfer(uint32_t channelStructIndex, uint32_t mode,
+        void * srcAddr, void * dstAddr, uint32_t transferSize);
+void DMA_assignInterrupt(uint32_t interruptNumber, uint32_t channel);
+void DMA_enableChannel(uint32_t channelNum);
+void DMA_disableChannel(uint32_t channelNum);
+void DMA_clearInterruptFlag(uint32_t channel);
+
+#endif /* DRIVERLIB_H_ */
@@ -0,0 +1,861 @@
+/********************************
+ * driverlib_stub.c
+ *
+ *  The MSP432 driverlib calls i2c_lcd.c makes, on a PC,
+ *  see driverlib_stub.h
+ *
+ *  Bus time is charged by the lcd_sim.c models (or here
+ *  for an address nobody answers), the CPU is charged one
+ *  MCLK tick per TIMER32_0 read so polling loops end.
+ *  Register writes the driver makes directly (TXSTP) are
+ *  acted on the next time it calls in here or an
+ *  interrupt handler returns.
+ *
+ ********************************/
+
+/********************************
+ * Includes
+ ********************************/
+#include <stdio.h>
+#include <string.h>
+#include <driverlib.h>
+#include "driverlib_stub.h"
+
+/********************************
+ * Types specific to file
+ ********************************/
+typedef struct STUB_Bus
+{
+    uint32_t base;
+    uint16_t interrupt;                 // INT_EUSCIBx
+    EUSCI_B_Type registers;
+    uint32_t dataRate;
+    uint16_t slaveAddress;
+    uint16_t enabled;                   // Interrupt enables
+    uint16_t flags;                     // Interrupt flags
+    bool started;                       // Between START and STOP
+    SIM_Lcd * target;                   // Who acknowledged, NULL on NAK
+    uint8_t deviceCount;
+    struct
+    {
+        uint8_t address;
+        SIM_Lcd * sim;
+    } devices[STUB_DEVICES];
+} STUB_Bus;
+
+typedef struct STUB_Channel
+{
+    STUB_Bus * trigger;                 // Bus whose TXIFG0 moves a byte
+    uint8_t * source;
+    uint32_t remaining;
+    bool enabled;
+    bool done;                          // Interrupt flag
+    uint32_t interrupt;                 // INT_DMA_INTx, 0 if not routed
+} STUB_Channel;
+
+/********************************
+ * File specific functions
+ ********************************/
+static STUB_Bus * _bus(uint32_t moduleInstance);
+static void _advanceNs(uint64_t durationNs);
+static void _chargeBits(STUB_Bus * bus, uint32_t bits);
+static void _start(STUB_Bus * bus);
+static void _write(STUB_Bus * bus, uint8_t data);
+static uint8_t _read(STUB_Bus * bus);
+static void _stop(STUB_Bus * bus);
+static void _pollRegisters(void);
+static void _dmaService(void);
+static bool _pending(uint32_t interruptNumber);
+static bool _sleepUntilTimer(void);
+static void _dispatch(void);
+
+/********************************
+ * Global variables specific to file
+ ********************************/
+#define BITS_PER_BYTE       9       // Same accounting as lcd_sim.c
+#define START_STOP_BITS     2
+#define THREAD_PRIORITY     0x100   // Below every interrupt
+#define CHANNEL_COUNT       8
+#define ACLK_HZ             32768
+
+static STUB_Bus _buses[] =
+{
+    { .base = EUSCI_B0_BASE, .interrupt = INT_EUSCIB0 },
+    { .base = EUSCI_B1_BASE, .interrupt = INT_EUSCIB1 },
+};
+#define BUS_COUNT           (sizeof(_buses) / sizeof(_buses[0]))
+
+static STUB_Channel _channels[CHANNEL_COUNT];
+
+static uint64_t _nowNs;
+static uint32_t _mclk;
+static uint32_t _smclk;
+
+static void (*_vectors[NUM_INTERRUPTS])(void);
+static bool _intEnabled[NUM_INTERRUPTS];
+static uint8_t _priority[NUM_INTERRUPTS];
+static bool _masterDisabled;
+static uint16_t _running = THREAD_PRIORITY;
+
+// TIMER32_1, one shot
+static bool _queueTimerRunning;
+static bool _queueTimerEnabled;
+static bool _queueTimerFlag;
+static uint32_t _queueTimerCount;
+static uint64_t _queueTimerDeadline;
+
+// Timer_A0 CCR0 in up mode on ACLK
+static bool _refreshRunning;
+static bool _refreshEnabled;
+static bool _refreshFlag;
+static uint64_t _refreshPeriodNs;
+static uint64_t _refreshDeadline;
+
+/********************************
+ * Power on: no devices, no interrupts, clock at zero.
+ * Handlers have to be registered again.
+ ********************************/
+void STUB_reset(uint32_t mclkHz, uint32_t smclkHz)
+{
+    uint8_t i;
+    for(i = 0; i < BUS_COUNT; i++)
+    {
+        uint32_t base = _buses[i].base;
+        uint16_t interrupt = _buses[i].interrupt;
+        memset(&_buses[i], 0, sizeof(STUB_Bus));
+        _buses[i].base = base;
+        _buses[i].interrupt = interrupt;
+    }
+
+    memset(_channels, 0, sizeof(_channels));
+    memset(_vectors, 0, sizeof(_vectors));
+    memset(_intEnabled, 0, sizeof(_intEnabled));
+    memset(_priority, 0, sizeof(_priority));
+
+    _nowNs = 0;
+    _mclk = mclkHz;
+    _smclk = smclkHz;
+    _masterDisabled = false;
+    _running = THREAD_PRIORITY;
+
+    _queueTimerRunning = false;
+    _queueTimerEnabled = false;
+    _queueTimerFlag = false;
+    _refreshRunning = false;
+    _refreshEnabled = false;
+    _refreshFlag = false;
+}
+
+/********************************
+ * Hang a model off a bus, it acknowledges slaveAddress
+ * Returns: 1 on success, 0 if the bus is full or unknown
+ ********************************/
+int STUB_attach(uint32_t moduleInstance, uint8_t slaveAddress, SIM_Lcd * sim)
+{
+    STUB_Bus * bus = _bus(moduleInstance);
+    if(!bus || bus->deviceCount == STUB_DEVICES)
+    {
+        return 0;
+    }
+
+    bus->devices[bus->deviceCount].address = slaveAddress;
+    bus->devices[bus->deviceCount].sim = sim;
+    bus->deviceCount++;
+    sim->nowNs = _nowNs;
+
+    return 1;
+}
+
+/********************************/
+uint64_t STUB_nowNs(void)
+{
+    return _nowNs;
+}
+
+/********************************
+ * The CPU idles for durationUs, whatever comes due on
+ * the way gets run
+ ********************************/
+void STUB_advance(uint32_t durationUs)
+{
+    uint64_t end = _nowNs + (uint64_t)durationUs * 1000;
+
+    while(_nowNs < end)
+    {
+        uint64_t next = end;
+        if(_refreshRunning && _refreshDeadline < next)
+        {
+            next = _refreshDeadline;
+        }
+        if(_queueTimerRunning && _queueTimerDeadline < next)
+        {
+            next = _queueTimerDeadline;
+        }
+
+        _advanceNs(next - _nowNs);
+        _dispatch();
+    }
+}
+
+/********************************
+ * EUSCI_B in I2C master mode
+ ********************************/
+EUSCI_B_Type * EUSCI_B_registers(uint32_t moduleInstance)
+{
+    return &_bus(moduleInstance)->registers;
+}
+
+void I2C_initMaster(uint32_t moduleInstance, const eUSCI_I2C_MasterConfig * config)
+{
+    STUB_Bus * bus = _bus(moduleInstance);
+    bus->dataRate = config->dataRate;
+    bus->registers.CTLW0 = EUSCI_B_CTLW0_TR;
+    bus->flags = 0;
+}
+
+void I2C_setSlaveAddress(uint32_t moduleInstance, uint_fast16_t slaveAddress)
+{
+    _bus(moduleInstance)->slaveAddress = slaveAddress;
+}
+
+void I2C_setMode(uint32_t moduleInstance, uint_fast8_t mode)
+{
+    STUB_Bus * bus = _bus(moduleInstance);
+    bus->registers.CTLW0 = (bus->registers.CTLW0 & ~EUSCI_B_CTLW0_TR) |
+                               (mode & EUSCI_B_CTLW0_TR);
+}
+
+void I2C_enableModule(uint32_t moduleInstance)
+{
+    (void)moduleInstance;
+}
+
+void I2C_disableModule(uint32_t moduleInstance)
+{
+    (void)moduleInstance;
+}
+
+void I2C_masterSendSingleByte(uint32_t moduleInstance, uint8_t txData)
+{
+    STUB_Bus * bus = _bus(moduleInstance);
+    _pollRegisters();
+    _start(bus);
+    _write(bus, txData);
+    _stop(bus);
+    _dispatch();
+}
+
+bool I2C_masterSendSingleByteWithTimeout(uint32_t moduleInstance, uint8_t txData, uint32_t timeout)
+{
+    (void)timeout;
+    I2C_masterSendSingleByte(moduleInstance, txData);
+    return true;
+}
+
+void I2C_masterSendMultiByteStart(uint32_t moduleInstance, uint8_t txData)
+{
+    STUB_Bus * bus = _bus(moduleInstance);
+    _pollRegisters();
+    _start(bus);
+    _write(bus, txData);
+    _dispatch();
+}
+
+void I2C_masterSendMultiByteNext(uint32_t moduleInstance, uint8_t txData)
+{
+    STUB_Bus * bus = _bus(moduleInstance);
+    _pollRegisters();
+    _write(bus, txData);
+    _dispatch();
+}
+
+void I2C_masterSendMultiByteFinish(uint32_t moduleInstance, uint8_t txData)
+{
+    STUB_Bus * bus = _bus(moduleInstance);
+    _pollRegisters();
+    _write(bus, txData);
+    _stop(bus);
+    _dispatch();
+}
+
+/********************************
+ * START and the address only, TXIFG0 or NAK follow
+ ********************************/
+void I2C_masterSendStart(uint32_t moduleInstance)
+{
+    STUB_Bus * bus = _bus(moduleInstance);
+    _pollRegisters();
+    _start(bus);
+    _dmaService();
+    _dispatch();
+}
+
+uint8_t I2C_masterReceiveSingleByte(uint32_t moduleInstance)
+{
+    STUB_Bus * bus = _bus(moduleInstance);
+    _pollRegisters();
+    I2C_setMode(moduleInstance, EUSCI_B_I2C_RECEIVE_MODE);
+    _start(bus);
+    uint8_t data = _read(bus);
+    _stop(bus);
+    _dispatch();
+
+    return data;
+}
+
+void I2C_enableInterrupt(uint32_t moduleInstance, uint_fast16_t mask)
+{
+    _bus(moduleInstance)->enabled |= mask;
+    _pollRegisters();
+    _dispatch();
+}
+
+void I2C_disableInterrupt(uint32_t moduleInstance, uint_fast16_t mask)
+{
+    _bus(moduleInstance)->enabled &= ~mask;
+}
+
+void I2C_clearInterruptFlag(uint32_t moduleInstance, uint_fast16_t mask)
+{
+    _bus(moduleInstance)->flags &= ~mask;
+    _pollRegisters();
+    _dispatch();
+}
+
+uint_fast16_t I2C_getInterruptStatus(uint32_t moduleInstance, uint16_t mask)
+{
+    _pollRegisters();
+    return _bus(moduleInstance)->flags & mask;
+}
+
+uint_fast16_t I2C_getEnabledInterruptStatus(uint32_t moduleInstance)
+{
+    STUB_Bus * bus = _bus(moduleInstance);
+    return bus->flags & bus->enabled;
+}
+
+uint32_t I2C_getTransmitBufferAddressForDMA(uint32_t moduleInstance)
+{
+    // Only ever handed back to DMA_setChannelTransfer, which knows the bus
+    (void)moduleInstance;
+    return 0;
+}
+
+void GPIO_setAsPeripheralModuleFunctionInputPin(uint_fast8_t selectedPort,
+        uint_fast16_t selectedPins, uint_fast8_t mode)
+{
+    (void)selectedPort;
+    (void)selectedPins;
+    (void)mode;
+}
+
+/********************************
+ * Timer32: TIMER32_0 free runs off the virtual
+ * clock, TIMER32_1 is the one shot queue timer
+ ********************************/
+void Timer32_initModule(uint32_t timer, uint32_t preScaler, uint32_t resolution, uint32_t mode)
+{
+    (void)timer;
+    (void)preScaler;
+    (void)resolution;
+    (void)mode;
+}
+
+void Timer32_setCount(uint32_t timer, uint32_t count)
+{
+    if(timer == TIMER32_1_BASE)
+    {
+        _queueTimerCount = count;
+    }
+}
+
+void Timer32_startTimer(uint32_t timer, bool oneShot)
+{
+    (void)oneShot;
+
+    if(timer == TIMER32_1_BASE)
+    {
+        _queueTimerDeadline = _nowNs + ((uint64_t)_queueTimerCount * 1000000000 + _mclk - 1) / _mclk;
+        _queueTimerRunning = true;
+        _dispatch();
+    }
+}
+
+/********************************
+ * Counts down from 0xFFFFFFFF. Every read costs an MCLK
+ * tick (rounded up so the count always moves).
+ ********************************/
+uint32_t Timer32_getValue(uint32_t timer)
+{
+    (void)timer;
+    _advanceNs((1000000000 + _mclk - 1) / _mclk);
+    _dispatch();
+
+    uint64_t ticks = (_nowNs * (_mclk / 1000)) / 1000000;
+    return ~(uint32_t)ticks;
+}
+
+void Timer32_enableInterrupt(uint32_t timer)
+{
+    if(timer == TIMER32_1_BASE)
+    {
+        _queueTimerEnabled = true;
+    }
+}
+
+void Timer32_clearInterruptFlag(uint32_t timer)
+{
+    if(timer == TIMER32_1_BASE)
+    {
+        _queueTimerFlag = false;
+    }
+}
+
+/********************************
+ * Timer_A0, the framebuffer refresh
+ ********************************/
+void Timer_A_configureUpMode(uint32_t timer, const Timer_A_UpModeConfig * config)
+{
+    (void)timer;
+    _refreshPeriodNs = ((uint64_t)config->timerPeriod * 1000000000) / ACLK_HZ;
+    _refreshEnabled = (config->captureCompareInterruptEnable_CCR0_CCIE != 0);
+    _refreshFlag = false;
+}
+
+void Timer_A_startCounter(uint32_t timer, uint_fast16_t timerMode)
+{
+    (void)timer;
+    (void)timerMode;
+    _refreshDeadline = _nowNs + _refreshPeriodNs;
+    _refreshRunning = true;
+}
+
+void Timer_A_stopTimer(uint32_t timer)
+{
+    (void)timer;
+    _refreshRunning = false;
+}
+
+void Timer_A_clearCaptureCompareInterrupt(uint32_t timer, uint_fast16_t captureCompareRegister)
+{
+    (void)timer;
+    (void)captureCompareRegister;
+    _refreshFlag = false;
+}
+
+/********************************/
+uint32_t CS_getMCLK(void)
+{
+    return _mclk;
+}
+
+uint32_t CS_getSMCLK(void)
+{
+    return _smclk;
+}
+
+uint32_t CS_getACLK(void)
+{
+    return ACLK_HZ;
+}
+
+/********************************
+ * NVIC. Priorities work like the real thing, lower
+ * runs first and can preempt, 0 is the reset value.
+ ********************************/
+void Interrupt_registerInterrupt(uint32_t interruptNumber, void (*intHandler)(void))
+{
+    _vectors[interruptNumber] = intHandler;
+}
+
+void Interrupt_enableInterrupt(uint32_t interruptNumber)
+{
+    _intEnabled[interruptNumber] = true;
+    _dispatch();
+}
+
+void Interrupt_disableInterrupt(uint32_t interruptNumber)
+{
+    _intEnabled[interruptNumber] = false;
+}
+
+void Interrupt_setPriority(uint32_t interruptNumber, uint8_t priority)
+{
+    _priority[interruptNumber] = priority;
+}
+
+/********************************
+ * Both return true if interrupts were already off
+ ********************************/
+bool Interrupt_enableMaster(void)
+{
+    bool wasDisabled = _masterDisabled;
+    _masterDisabled = false;
+    _dispatch();
+
+    return wasDisabled;
+}
+
+bool Interrupt_disableMaster(void)
+{
+    bool wasDisabled = _masterDisabled;
+    _masterDisabled = true;
+
+    return wasDisabled;
+}
+
+/********************************
+ * uDMA, basic mode from memory to an EUSCI_B TXBUF
+ ********************************/
+void DMA_enableModule(void)
+{
+}
+
+void DMA_setControlBase(void * controlTable)
+{
+    (void)controlTable;
+}
+
+/********************************
+ * Source 1 on channels 0 and 2 is EUSCI_B0 and B1 TX0
+ ********************************/
+void DMA_assignChannel(uint32_t mapping)
+{
+    uint8_t channel = mapping & 0xFF;
+
+    if(channel < CHANNEL_COUNT)
+    {
+        _channels[channel].trigger = ((mapping >> 24) == 1 && channel / 2 < BUS_COUNT) ?
+                                         &_buses[channel / 2] : NULL;
+    }
+}
+
+void DMA_setChannelControl(uint32_t channelStructIndex, uint32_t control)
+{
+    (void)channelStructIndex;
+    (void)control;
+}
+
+void DMA_setChannelTransfer(uint32_t channelStructIndex, uint32_t mode,
+        void * srcAddr, void * dstAddr, uint32_t transferSize)
+{
+    (void)mode;
+    (void)dstAddr;
+
+    STUB_Channel * channel = &_channels[channelStructIndex & (CHANNEL_COUNT - 1)];
+    channel->source = srcAddr;
+    channel->remaining = transferSize;
+}
+
+void DMA_assignInterrupt(uint32_t interruptNumber, uint32_t channel)
+{
+    _channels[channel].interrupt = interruptNumber;
+}
+
+void DMA_enableChannel(uint32_t channelNum)
+{
+    _channels[channelNum].enabled = true;
+    _dmaService();
+    _dispatch();
+}
+
+void DMA_disableChannel(uint32_t channelNum)
+{
+    _channels[channelNum].enabled = false;
+}
+
+void DMA_clearInterruptFlag(uint32_t channel)
+{
+    _channels[channel].done = false;
+}
+
+/********************************/
+static STUB_Bus * _bus(uint32_t moduleInstance)
+{
+    uint8_t i;
+    for(i = 0; i < BUS_COUNT; i++)
+    {
+        if(_buses[i].base == moduleInstance)
+        {
+            return &_buses[i];
+        }
+    }
+
+    fprintf(stderr, "driverlib stub: no EUSCI_B at 0x%08X\n", (unsigned)moduleInstance);
+    return NULL;
+}
+
+/********************************
+ * Move the clock and raise the timer flags that
+ * came due on the way
+ ********************************/
+static void _advanceNs(uint64_t durationNs)
+{
+    _nowNs += durationNs;
+
+    if(_queueTimerRunning && _nowNs >= _queueTimerDeadline)
+    {
+        _queueTimerRunning = false;
+        _queueTimerFlag = true;
+    }
+
+    while(_refreshRunning && _refreshPeriodNs && _nowNs >= _refreshDeadline)
+    {
+        _refreshFlag = true;
+        _refreshDeadline += _refreshPeriodNs;
+    }
+}
+
+/********************************
+ * Bus time when no model is listening
+ ********************************/
+static void _chargeBits(STUB_Bus * bus, uint32_t bits)
+{
+    _advanceNs(((uint64_t)bits * 1000000000) / bus->dataRate);
+}
+
+/********************************
+ * START and address byte, the models keep their own
+ * clocks so bring them up to date around every call
+ ********************************/
+static void _start(STUB_Bus * bus)
+{
+    bus->target = NULL;
+    bus->started = true;
+
+    uint8_t i;
+    for(i = 0; i < bus->deviceCount; i++)
+    {
+        if(bus->devices[i].address == bus->slaveAddress)
+        {
+            bus->target = bus->devices[i].sim;
+        }
+    }
+
+    if(bus->target && bus->target->nackAddresses)
+    {
+        bus->target->nackAddresses--;
+        bus->target = NULL;
+    }
+
+    // Too fast for this expander, it misses its address
+    if(bus->target && bus->target->maxSclHz && bus->dataRate > bus->target->maxSclHz)
+    {
+        bus->target = NULL;
+    }
+
+    if(!bus->target)
+    {
+        _chargeBits(bus, START_STOP_BITS / 2 + BITS_PER_BYTE);
+        bus->flags |= EUSCI_B_I2C_NAK_INTERRUPT;
+        return;
+    }
+
+    SIM_Lcd * sim = bus->target;
+    sim->sclHz = bus->dataRate;
+    sim->nowNs = _nowNs;
+    SIM_start(sim);
+    _advanceNs(sim->nowNs - _nowNs);
+
+    bus->flags |= EUSCI_B_I2C_TRANSMIT_INTERRUPT0;
+}
+
+/********************************
+ * After a NAK the master sends nothing more
+ ********************************/
+static void _write(STUB_Bus * bus, uint8_t data)
+{
+    SIM_Lcd * sim = bus->target;
+    if(!sim || !bus->started)
+    {
+        return;
+    }
+
+    bus->registers.TXBUF = data;
+    sim->nowNs = _nowNs;
+    SIM_write(sim, data);
+    _advanceNs(sim->nowNs - _nowNs);
+
+    bus->flags |= EUSCI_B_I2C_TRANSMIT_INTERRUPT0;
+}
+
+/********************************
+ * Nobody driving SDA reads as all ones
+ ********************************/
+static uint8_t _read(STUB_Bus * bus)
+{
+    SIM_Lcd * sim = bus->target;
+    if(!sim)
+    {
+        return 0xFF;
+    }
+
+    sim->nowNs = _nowNs;
+    uint8_t data = SIM_read(sim);
+    _advanceNs(sim->nowNs - _nowNs);
+
+    return data;
+}
+
+/********************************
+ * TXIFG0 doesn't outlive the transaction
+ ********************************/
+static void _stop(STUB_Bus * bus)
+{
+    if(!bus->started)
+    {
+        return;
+    }
+
+    if(bus->target)
+    {
+        SIM_Lcd * sim = bus->target;
+        sim->nowNs = _nowNs;
+        SIM_stop(sim);
+        _advanceNs(sim->nowNs - _nowNs);
+    }
+    else
+    {
+        _chargeBits(bus, START_STOP_BITS / 2);
+    }
+
+    bus->started = false;
+    bus->target = NULL;
+    bus->flags &= ~EUSCI_B_I2C_TRANSMIT_INTERRUPT0;
+    bus->flags |= EUSCI_B_I2C_STOP_INTERRUPT;
+}
+
+/********************************
+ * UCTXSTP set by the driver: send STOP and clear it
+ ********************************/
+static void _pollRegisters(void)
+{
+    uint8_t i;
+    for(i = 0; i < BUS_COUNT; i++)
+    {
+        STUB_Bus * bus = &_buses[i];
+        if(bus->registers.CTLW0 & EUSCI_B_CTLW0_TXSTP)
+        {
+            bus->registers.CTLW0 &= ~EUSCI_B_CTLW0_TXSTP;
+            _stop(bus);
+        }
+    }
+}
+
+/********************************
+ * An armed channel empties itself into TXBUF as fast
+ * as the bus takes it. TXIFG0 is up again after the
+ * last byte, the driver waits for it to send STOP.
+ ********************************/
+static void _dmaService(void)
+{
+    uint8_t i;
+    for(i = 0; i < CHANNEL_COUNT; i++)
+    {
+        STUB_Channel * channel = &_channels[i];
+        STUB_Bus * bus = channel->trigger;
+
+        if(!channel->enabled || !bus || !bus->started ||
+           !(bus->flags & EUSCI_B_I2C_TRANSMIT_INTERRUPT0))
+        {
+            continue;
+        }
+
+        while(channel->remaining)
+        {
+            _write(bus, *channel->source++);
+            channel->remaining--;
+        }
+
+        channel->enabled = false;
+        channel->done = true;
+    }
+}
+
+/********************************/
+static bool _pending(uint32_t interruptNumber)
+{
+    uint8_t i;
+    for(i = 0; i < BUS_COUNT; i++)
+    {
+        if(_buses[i].interrupt == interruptNumber)
+        {
+            return (_buses[i].flags & _buses[i].enabled) != 0;
+        }
+    }
+
+    for(i = 0; i < CHANNEL_COUNT; i++)
+    {
+        if(_channels[i].done && _channels[i].interrupt == interruptNumber)
+        {
+            return true;
+        }
+    }
+
+    if(interruptNumber == INT_T32_INT2)
+    {
+        return _queueTimerFlag && _queueTimerEnabled;
+    }
+
+    if(interruptNumber == INT_TA0_0)
+    {
+        return _refreshFlag && _refreshEnabled;
+    }
+
+    return false;
+}
+
+/********************************
+ * Nothing to run and the driver is waiting on the
+ * queue timer: sleep through to it
+ * Returns: true if time moved
+ ********************************/
+static bool _sleepUntilTimer(void)
+{
+    if(_running != THREAD_PRIORITY || !_queueTimerRunning ||
+       !_queueTimerEnabled || !_intEnabled[INT_T32_INT2])
+    {
+        return false;
+    }
+
+    _advanceNs(_queueTimerDeadline - _nowNs);
+    return true;
+}
+
+/********************************
+ * Run whatever is pending and allowed to preempt the
+ * current priority, most urgent first. Handlers that
+ * call back in here nest the way the NVIC would.
+ ********************************/
+static void _dispatch(void)
+{
+    while(!_masterDisabled)
+    {
+        _pollRegisters();
+
+        uint32_t best = NUM_INTERRUPTS;
+        uint32_t i;
+        for(i = 0; i < NUM_INTERRUPTS; i++)
+        {
+            if(_vectors[i] && _intEnabled[i] && _priority[i] < _running && _pending(i) &&
+               (best == NUM_INTERRUPTS || _priority[i] < _priority[best]))
+            {
+                best = i;
+            }
+        }
+
+        if(best == NUM_INTERRUPTS)
+        {
+            if(!_sleepUntilTimer())
+            {
+                return;
+            }
+            continue;
+        }
+
+        uint16_t interrupted = _running;
+        _running = _priority[best];
+        _vectors[best]();
+        _running = interrupted;
+    }
+}
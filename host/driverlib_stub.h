@@ -0,0 +1,34 @@
+/********************************
+ * driverlib_stub.h
+ *
+ *  Runs i2c_lcd.c on a PC. host/driverlib/driverlib.h
+ *  stands in for the MSP432 driverlib: bytes sent on an
+ *  EUSCI_B go to the lcd_sim.c model attached at that
+ *  slave address, and TIMER32_0 counts on a virtual clock
+ *  that only moves with bus time and CPU polling.
+ *
+ *  Interrupts are run in the caller's context as soon as
+ *  a flag they're enabled for goes up, higher priority
+ *  ones first, registered with Interrupt_registerInterrupt
+ *  like a RAM vector table. So a DMA or queued transfer
+ *  is over by the time the call that started it returns.
+ *  When nothing else can run the CPU sleeps until the
+ *  TIMER32_1 deadline, STUB_advance lets time pass for the
+ *  Timer_A0 refresh.
+ *
+ ********************************/
+
+#ifndef DRIVERLIB_STUB_H_
+#define DRIVERLIB_STUB_H_
+
+#include <stdint.h>
+#include "lcd_sim.h"
+
+#define STUB_DEVICES            4       // Models per bus
+
+void STUB_reset(uint32_t mclkHz, uint32_t smclkHz);
+int STUB_attach(uint32_t moduleInstance, uint8_t slaveAddress, SIM_Lcd * sim);
+uint64_t STUB_nowNs(void);
+void STUB_advance(uint32_t durationUs);
+
+#endif /* DRIVERLIB_STUB_H_ */
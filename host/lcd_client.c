@@ -0,0 +1,531 @@
+/********************************
+ * lcd_client.c
+ *
+ *  Drives the example's LCD from a PC over the USB UART,
+ *  see lcd_client.h
+ *
+ *  POSIX only. CLIENT_attach takes any file descriptor, so
+ *  the master side of a pty can stand in for the device.
+ *
+ ********************************/
+
+/********************************
+ * Includes
+ ********************************/
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "lcd_client.h"
+#define PROTO_HOST
+#include "../src/protocol.h"
+
+/********************************
+ * File specific functions
+ ********************************/
+static uint64_t _nowMs(void);
+static uint16_t _crcUpdate(uint16_t crc, uint8_t data);
+static uint8_t _frame(CLIENT_Lcd * client, uint8_t * buffer, uint8_t op, const uint8_t * payload, uint8_t length);
+static uint8_t _runs(CLIENT_Lcd * client, uint8_t row, uint8_t starts[], uint8_t ends[]);
+static int _pump(CLIENT_Lcd * client);
+static int _wait(CLIENT_Lcd * client, int timeoutMs);
+static void _receive(CLIENT_Lcd * client, uint8_t data);
+static void _ack(CLIENT_Lcd * client, uint8_t seq, uint8_t status, uint8_t window);
+static void _lost(CLIENT_Lcd * client);
+
+/********************************
+ * Global variables specific to file
+ ********************************/
+#define CRC_INIT            0xFFFF
+#define CRC_POLY            0x1021
+#define WRITE_AT_OVERHEAD   (PROTO_OVERHEAD + 2)        // Row and column
+#define BLIT_COST           (PROTO_OVERHEAD + CLIENT_ROWS * CLIENT_COLUMNS)
+#define ACK_LENGTH          (PROTO_OVERHEAD + 2)
+#define MAX_RUNS            (CLIENT_COLUMNS / 2 + 1)
+
+static const struct
+{
+    uint32_t baudRate;
+    speed_t speed;
+} _speeds[] =
+{
+    { 9600,     B9600 },
+    { 19200,    B19200 },
+    { 38400,    B38400 },
+    { 57600,    B57600 },
+    { 115200,   B115200 },
+    { 230400,   B230400 },
+};
+
+/********************************
+ * Open a serial port raw at baudRate and attach to it
+ * Returns: 1 if successful, 0 if failed
+ ********************************/
+int CLIENT_open(CLIENT_Lcd * client, const char * path, uint32_t baudRate)
+{
+    speed_t speed = 0;
+    uint8_t i;
+    for(i = 0; i < sizeof(_speeds) / sizeof(_speeds[0]); i++)
+    {
+        if(_speeds[i].baudRate == baudRate)
+        {
+            speed = _speeds[i].speed;
+        }
+    }
+
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if(speed == 0 || fd < 0)
+    {
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+        return 0;
+    }
+
+    struct termios tty;
+    if(tcgetattr(fd, &tty) != 0)
+    {
+        close(fd);
+        return 0;
+    }
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, speed);
+    cfsetospeed(&tty, speed);
+    tcsetattr(fd, TCSANOW, &tty);
+    tcflush(fd, TCIOFLUSH);
+
+    if(!CLIENT_attach(client, fd))
+    {
+        close(fd);
+        return 0;
+    }
+
+    return 1;
+}
+
+/********************************
+ * Take over an open descriptor and learn the
+ * device's window with HELLO
+ * Returns: 1 if the device answered, 0 if not
+ ********************************/
+int CLIENT_attach(CLIENT_Lcd * client, int fd)
+{
+    memset(client, 0, sizeof(*client));
+    memset(client->screen, ' ', sizeof(client->screen));
+    client->fd = fd;
+    client->window = PROTO_OVERHEAD;
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    uint8_t frame[PROTO_OVERHEAD];
+    uint8_t length = _frame(client, frame, PROTO_OP_HELLO, NULL, 0);
+    if(write(fd, frame, length) != length)
+    {
+        return 0;
+    }
+    client->writes++;
+
+    uint64_t deadline = _nowMs() + CLIENT_ACK_TIMEOUT_MS;
+    while(client->pendingCount)
+    {
+        int64_t left = (int64_t)(deadline - _nowMs());
+        if(left <= 0 || !_wait(client, (int)left))
+        {
+            return 0;
+        }
+    }
+
+    // Whatever is on the device now gets overwritten by the first poll
+    client->shownValid = false;
+    client->errors = 0;
+    return 1;
+}
+
+/********************************/
+void CLIENT_close(CLIENT_Lcd * client)
+{
+    if(client->fd >= 0)
+    {
+        close(client->fd);
+        client->fd = -1;
+    }
+}
+
+/********************************
+ * Write text into the local screen, clipped at the edge
+ * Nothing is sent until CLIENT_poll
+ * Returns: 1 if successful, 0 if out of range
+ ********************************/
+int CLIENT_setText(CLIENT_Lcd * client, uint8_t row, uint8_t col, const char * text)
+{
+    if(row >= CLIENT_ROWS || col >= CLIENT_COLUMNS)
+    {
+        return 0;
+    }
+
+    while(*text && col < CLIENT_COLUMNS)
+    {
+        client->screen[row][col++] = (uint8_t)*text++;
+    }
+
+    return 1;
+}
+
+/********************************
+ * Send what changed as far as the window allows,
+ * then wait up to timeoutMs for ACKs and send again
+ * Returns: 1 if successful, 0 if the port failed
+ ********************************/
+int CLIENT_poll(CLIENT_Lcd * client, int timeoutMs)
+{
+    if(!_pump(client))
+    {
+        return 0;
+    }
+
+    if(client->pendingCount && !_wait(client, timeoutMs))
+    {
+        return 0;
+    }
+
+    return _pump(client);
+}
+
+/********************************
+ * Poll until the device shows the local screen
+ * Returns: 1 if it does, 0 on timeout or port failure
+ ********************************/
+int CLIENT_sync(CLIENT_Lcd * client, int timeoutMs)
+{
+    uint64_t deadline = _nowMs() + timeoutMs;
+
+    while(1)
+    {
+        int64_t left = (int64_t)(deadline - _nowMs());
+        if(left < 0 || !CLIENT_poll(client, (int)left))
+        {
+            return 0;
+        }
+
+        if(client->pendingCount == 0 && client->shownValid &&
+           memcmp(client->screen, client->shown, sizeof(client->shown)) == 0)
+        {
+            return 1;
+        }
+    }
+}
+
+/********************************
+ * Plan frames for every difference and send them in
+ * one write. Close runs are merged since the gap is
+ * cheaper than another frame header, and when the runs
+ * cost more than the whole screen it is blitted instead.
+ ********************************/
+static int _pump(CLIENT_Lcd * client)
+{
+    // A frame whose ACK never came may or may not have landed
+    if(client->pendingCount && _nowMs() - client->lastAckMs > CLIENT_ACK_TIMEOUT_MS)
+    {
+        _lost(client);
+    }
+
+    uint8_t starts[CLIENT_ROWS][MAX_RUNS];
+    uint8_t ends[CLIENT_ROWS][MAX_RUNS];
+    uint8_t count[CLIENT_ROWS];
+    uint16_t cost = 0;
+    uint8_t row;
+
+    for(row = 0; row < CLIENT_ROWS; row++)
+    {
+        count[row] = _runs(client, row, starts[row], ends[row]);
+
+        uint8_t run;
+        for(run = 0; run < count[row]; run++)
+        {
+            cost += WRITE_AT_OVERHEAD + ends[row][run] - starts[row][run];
+        }
+    }
+
+    if(client->shownValid && cost == 0)
+    {
+        return 1;
+    }
+
+    uint8_t buffer[2 * BLIT_COST + CLIENT_ROWS * MAX_RUNS * WRITE_AT_OVERHEAD];
+    uint16_t length = 0;
+
+    if(!client->shownValid || cost >= BLIT_COST)
+    {
+        if(client->unacked + BLIT_COST > client->window || client->pendingCount == CLIENT_MAX_PENDING)
+        {
+            return 1;
+        }
+
+        length = _frame(client, buffer, PROTO_OP_BLIT, &client->screen[0][0], sizeof(client->screen));
+        memcpy(client->shown, client->screen, sizeof(client->shown));
+        client->shownValid = true;
+    }
+    else
+    {
+        for(row = 0; row < CLIENT_ROWS; row++)
+        {
+            uint8_t run;
+            for(run = 0; run < count[row]; run++)
+            {
+                uint8_t start = starts[row][run];
+                uint8_t width = ends[row][run] - start;
+
+                if(client->unacked + WRITE_AT_OVERHEAD + width > client->window ||
+                   client->pendingCount == CLIENT_MAX_PENDING)
+                {
+                    break;
+                }
+
+                uint8_t payload[2 + CLIENT_COLUMNS] = { row, start };
+                memcpy(&payload[2], &client->screen[row][start], width);
+                length += _frame(client, &buffer[length], PROTO_OP_WRITE_AT, payload, 2 + width);
+                memcpy(&client->shown[row][start], &client->screen[row][start], width);
+            }
+        }
+    }
+
+    uint16_t sent = 0;
+    while(sent < length)
+    {
+        ssize_t result = write(client->fd, &buffer[sent], length - sent);
+        if(result < 0 && errno != EAGAIN)
+        {
+            return 0;
+        }
+        if(result < 0)
+        {
+            struct pollfd out = { client->fd, POLLOUT, 0 };
+            poll(&out, 1, CLIENT_ACK_TIMEOUT_MS);
+            continue;
+        }
+        sent += result;
+        client->writes++;
+    }
+
+    return 1;
+}
+
+/********************************
+ * Runs of cells in a row that differ from what was sent,
+ * merged while the gap is shorter than a frame header
+ * Returns: number of runs, ends are exclusive
+ ********************************/
+static uint8_t _runs(CLIENT_Lcd * client, uint8_t row, uint8_t starts[], uint8_t ends[])
+{
+    uint8_t count = 0;
+    uint8_t col;
+
+    for(col = 0; col < CLIENT_COLUMNS; col++)
+    {
+        if(client->screen[row][col] == client->shown[row][col])
+        {
+            continue;
+        }
+
+        if(count && col - ends[count - 1] < WRITE_AT_OVERHEAD)
+        {
+            ends[count - 1] = col + 1;
+        }
+        else
+        {
+            starts[count] = col;
+            ends[count] = col + 1;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/********************************
+ * Build one frame and remember it until its ACK
+ * Returns: frame length
+ ********************************/
+static uint8_t _frame(CLIENT_Lcd * client, uint8_t * buffer, uint8_t op, const uint8_t * payload, uint8_t length)
+{
+    buffer[0] = PROTO_SYNC;
+    buffer[1] = length + 1;
+    buffer[2] = client->seq;
+    buffer[3] = op;
+    if(length)
+    {
+        memcpy(&buffer[4], payload, length);
+    }
+
+    uint16_t crc = CRC_INIT;
+    uint8_t i;
+    for(i = 1; i < 4 + length; i++)
+    {
+        crc = _crcUpdate(crc, buffer[i]);
+    }
+    buffer[4 + length] = crc & 0xFF;
+    buffer[5 + length] = crc >> 8;
+
+    uint8_t frameLength = PROTO_OVERHEAD + length;
+    uint8_t slot = (client->pendingHead + client->pendingCount) % CLIENT_MAX_PENDING;
+    client->pendingSeq[slot] = client->seq++;
+    client->pendingLength[slot] = frameLength;
+    if(client->pendingCount++ == 0)
+    {
+        client->lastAckMs = _nowMs();
+    }
+    client->unacked += frameLength;
+    client->frames++;
+    client->bytes += frameLength;
+
+    return frameLength;
+}
+
+/********************************
+ * Read ACKs for up to timeoutMs, returns early once
+ * something arrived
+ * Returns: 1 if successful, 0 if the port failed
+ ********************************/
+static int _wait(CLIENT_Lcd * client, int timeoutMs)
+{
+    struct pollfd in = { client->fd, POLLIN, 0 };
+    if(poll(&in, 1, timeoutMs) < 0)
+    {
+        return errno == EINTR;
+    }
+
+    uint8_t buffer[256];
+    ssize_t result;
+    while((result = read(client->fd, buffer, sizeof(buffer))) > 0)
+    {
+        ssize_t i;
+        for(i = 0; i < result; i++)
+        {
+            _receive(client, buffer[i]);
+        }
+    }
+
+    return result == 0 || errno == EAGAIN;
+}
+
+/********************************
+ * ACK parser, anything that isn't an ACK frame
+ * (console echo, noise) is skipped
+ ********************************/
+static void _receive(CLIENT_Lcd * client, uint8_t data)
+{
+    if(client->rxLength == 0 && data != PROTO_SYNC)
+    {
+        return;
+    }
+
+    if(client->rxLength == 1 && data != 3)
+    {
+        client->rxLength = 0;
+        return;
+    }
+
+    client->rx[client->rxLength++] = data;
+    if(client->rxLength < ACK_LENGTH)
+    {
+        return;
+    }
+    client->rxLength = 0;
+
+    uint16_t crc = CRC_INIT;
+    uint8_t i;
+    for(i = 1; i < PROTO_OVERHEAD; i++)
+    {
+        crc = _crcUpdate(crc, client->rx[i]);
+    }
+
+    if(client->rx[3] == PROTO_OP_ACK && client->rx[6] == (crc & 0xFF) && client->rx[7] == (crc >> 8))
+    {
+        _ack(client, client->rx[2], client->rx[4], client->rx[5]);
+    }
+}
+
+/********************************
+ * Retire frames up to seq, frames skipped over were
+ * lost so the device's screen is no longer known
+ ********************************/
+static void _ack(CLIENT_Lcd * client, uint8_t seq, uint8_t status, uint8_t window)
+{
+    uint8_t i;
+    for(i = 0; i < client->pendingCount; i++)
+    {
+        if(client->pendingSeq[(client->pendingHead + i) % CLIENT_MAX_PENDING] == seq)
+        {
+            break;
+        }
+    }
+
+    if(i == client->pendingCount)
+    {
+        return;     // Not ours or already timed out
+    }
+
+    while(1)
+    {
+        uint8_t head = client->pendingHead;
+        client->unacked -= client->pendingLength[head];
+        client->pendingHead = (head + 1) % CLIENT_MAX_PENDING;
+        client->pendingCount--;
+
+        if(client->pendingSeq[head] == seq)
+        {
+            break;
+        }
+        client->errors++;
+        client->shownValid = false;
+    }
+
+    if(status != PROTO_OK)
+    {
+        client->errors++;
+        client->shownValid = false;
+    }
+
+    client->window = window;
+    client->lastAckMs = _nowMs();
+}
+
+/********************************
+ * Give up on everything in flight and resend the screen
+ ********************************/
+static void _lost(CLIENT_Lcd * client)
+{
+    client->pendingCount = 0;
+    client->unacked = 0;
+    client->shownValid = false;
+    client->errors++;
+}
+
+/********************************/
+static uint64_t _nowMs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/********************************
+ * CRC-16/CCITT, same as the device
+ ********************************/
+static uint16_t _crcUpdate(uint16_t crc, uint8_t data)
+{
+    crc ^= (uint16_t)data << 8;
+
+    uint8_t bit;
+    for(bit = 0; bit < 8; bit++)
+    {
+        crc = (crc & 0x8000) ? (crc << 1) ^ CRC_POLY : crc << 1;
+    }
+
+    return crc;
+}
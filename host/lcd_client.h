@@ -0,0 +1,61 @@
+/********************************
+ * lcd_client.h
+ *
+ *  Drives the example's LCD from a PC over the USB UART
+ *  with the binary protocol in src/protocol.h.
+ *
+ *  Callers write text into a local copy of the 16x2 screen
+ *  as often as they like. CLIENT_poll works out which cells
+ *  differ from what the device shows, packs them into as
+ *  few frames as it can, sends them in one write and never
+ *  has more unacknowledged bytes out than the device's
+ *  window. Text written while the link is busy just
+ *  replaces what was waiting, the newest text wins.
+ *
+ ********************************/
+
+#ifndef LCD_CLIENT_H_
+#define LCD_CLIENT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CLIENT_ROWS             2
+#define CLIENT_COLUMNS          16
+#define CLIENT_MAX_PENDING      32      // Frames out without an ACK
+#define CLIENT_ACK_TIMEOUT_MS   500     // Then assume they were lost
+
+typedef struct CLIENT_Lcd
+{
+    int fd;                             // Serial port or pty
+
+    uint8_t screen[CLIENT_ROWS][CLIENT_COLUMNS];    // What the caller wants
+    uint8_t shown[CLIENT_ROWS][CLIENT_COLUMNS];     // What has been sent
+    bool shownValid;                    // False until sent once or after an error
+
+    uint16_t window;                    // Unacknowledged bytes the device allows
+    uint16_t unacked;
+    uint8_t seq;
+    uint8_t pendingSeq[CLIENT_MAX_PENDING];
+    uint8_t pendingLength[CLIENT_MAX_PENDING];
+    uint8_t pendingHead;
+    uint8_t pendingCount;
+    uint64_t lastAckMs;
+
+    uint8_t rx[8];                      // ACK being received
+    uint8_t rxLength;
+
+    uint32_t frames;                    // Frames sent
+    uint32_t bytes;                     // Bytes sent
+    uint32_t writes;                    // write() calls
+    uint32_t errors;                    // NAKs and timeouts
+} CLIENT_Lcd;
+
+int CLIENT_open(CLIENT_Lcd * client, const char * path, uint32_t baudRate);
+int CLIENT_attach(CLIENT_Lcd * client, int fd);
+void CLIENT_close(CLIENT_Lcd * client);
+int CLIENT_setText(CLIENT_Lcd * client, uint8_t row, uint8_t col, const char * text);
+int CLIENT_poll(CLIENT_Lcd * client, int timeoutMs);
+int CLIENT_sync(CLIENT_Lcd * client, int timeoutMs);
+
+#endif /* LCD_CLIENT_H_ */
@@ -0,0 +1,355 @@
+/********************************
+ * lcd_sim.c
+ *
+ *  Software model of a PCF8574 backpack driving a
+ *  HD44780 16x2 LCD, see lcd_sim.h
+ *
+ *  Based on the data sheet found here:
+ *  https://www.sparkfun.com/datasheets/LCD/HD44780.pdf
+ *
+ *  Only what i2c_lcd.c uses is modeled: 4 bit interface,
+ *  2 line mode, 5x8 font. Instructions still run when they
+ *  arrive too early, they are counted in violations so a
+ *  timing bug shows up as a number instead of garbage.
+ *
+ ********************************/
+
+/********************************
+ * Includes
+ ********************************/
+#include <string.h>
+#include "lcd_sim.h"
+#include "../i2c_lcd.h"
+
+/********************************
+ * File specific functions
+ ********************************/
+static void _chargeBits(SIM_Lcd * sim, uint32_t bits);
+static void _enableFalling(SIM_Lcd * sim);
+static void _instruction(SIM_Lcd * sim, uint8_t value);
+static void _data(SIM_Lcd * sim, uint8_t value);
+static void _busy(SIM_Lcd * sim, uint32_t durationUs);
+static void _stepAddress(SIM_Lcd * sim);
+static uint8_t _status(SIM_Lcd * sim);
+
+/********************************
+ * Global variables specific to file
+ ********************************/
+#define BITS_PER_BYTE       9       // 8 data bits and ACK
+#define START_STOP_BITS     2       // Roughly a bit time each for START and STOP
+#define POWER_UP_US         40000   // Wait after power rises above 2.7V (page 46)
+#define FIRST_RESET_US      4100    // First 8 bit function set
+#define SECOND_RESET_US     100     // Second 8 bit function set
+#define EXECUTE_US          37      // Most instructions
+#define CLEAR_HOME_US       1520    // Clear display and return home
+#define ROW_ADDRESS_MASK    0x40
+
+/********************************
+ * Power up state (page 23), the clock starts at
+ * the moment power is good
+ ********************************/
+void SIM_init(SIM_Lcd * sim, uint32_t sclHz)
+{
+    memset(sim, 0, sizeof(SIM_Lcd));
+
+    sim->sclHz = sclHz;
+    sim->busyUntilNs = (uint64_t)POWER_UP_US * 1000;
+    sim->eightBit = true;
+    sim->entryMode = LCD_ENTRYLEFT;
+    sim->functionSet = LCD_FUNCTIONSET | 0x10;
+
+    // DDRAM powers up as spaces, CGRAM is random (zeros will do)
+    memset(sim->ddram, ' ', sizeof(sim->ddram));
+}
+
+/********************************
+ * START condition plus address byte
+ ********************************/
+void SIM_start(SIM_Lcd * sim)
+{
+    sim->transactions++;
+    _chargeBits(sim, START_STOP_BITS / 2 + BITS_PER_BYTE);
+}
+
+/********************************
+ * One byte to the PCF8574, its pins change when it is
+ * acknowledged. The LCD latches on E falling (page 58).
+ ********************************/
+void SIM_write(SIM_Lcd * sim, uint8_t data)
+{
+    sim->bytes++;
+    _chargeBits(sim, BITS_PER_BYTE);
+
+    uint8_t previous = sim->pins;
+    sim->pins = data;
+
+    if((previous & ENABLE_BIT) && !(data & ENABLE_BIT))
+    {
+        _enableFalling(sim);
+    }
+}
+
+/********************************
+ * One byte from the PCF8574. Its pins are quasi
+ * bidirectional: a pin written high reads whatever the
+ * LCD drives, a pin written low always reads low.
+ ********************************/
+uint8_t SIM_read(SIM_Lcd * sim)
+{
+    sim->bytes++;
+    _chargeBits(sim, BITS_PER_BYTE);
+
+    uint8_t pins = sim->pins;
+    if(!sim->readWriteGrounded && (pins & READ_WRITE_BIT) &&
+       !(pins & REG_SELECT_BIT) && (pins & ENABLE_BIT))
+    {
+        // Which nibble is out depends on how many E pulses we've had
+        uint8_t status = _status(sim);
+        uint8_t nibble = sim->lowNibble ? (status << 4) : (status & 0xF0);
+        pins &= (nibble | 0x0F);
+    }
+
+    return pins;
+}
+
+/********************************/
+void SIM_stop(SIM_Lcd * sim)
+{
+    _chargeBits(sim, START_STOP_BITS / 2);
+}
+
+/********************************
+ * Time passing with nothing on the bus
+ ********************************/
+void SIM_delay(SIM_Lcd * sim, uint32_t durationUs)
+{
+    sim->nowNs += (uint64_t)durationUs * 1000;
+}
+
+/********************************
+ * The 16 characters a row is showing, text must
+ * have room for SIM_COLUMNS + 1
+ ********************************/
+void SIM_visibleRow(SIM_Lcd * sim, uint8_t row, char * text)
+{
+    uint8_t col;
+    for(col = 0; col < SIM_COLUMNS; col++)
+    {
+        text[col] = sim->ddram[row][(col + sim->shift) % SIM_LINE_LENGTH];
+    }
+
+    text[SIM_COLUMNS] = '\0';
+}
+
+/********************************/
+static void _chargeBits(SIM_Lcd * sim, uint32_t bits)
+{
+    sim->nowNs += ((uint64_t)bits * 1000000000) / sim->sclHz;
+}
+
+/********************************
+ * A nibble has been latched, writes only
+ * Reads just step the nibble phase. With R/W grounded
+ * there are no reads, the LCD latches whatever is on
+ * the data pins.
+ ********************************/
+static void _enableFalling(SIM_Lcd * sim)
+{
+    uint8_t nibble = sim->pins & 0xF0;
+
+    if((sim->pins & READ_WRITE_BIT) && !sim->readWriteGrounded)
+    {
+        sim->lowNibble = !sim->lowNibble;
+        return;
+    }
+
+    if(sim->nowNs < sim->busyUntilNs)
+    {
+        sim->violations++;
+    }
+
+    // 8 bit mode: D3-D0 aren't wired, they read as zero
+    if(sim->eightBit)
+    {
+        _instruction(sim, nibble);
+        return;
+    }
+
+    if(!sim->lowNibble)
+    {
+        sim->highNibble = nibble;
+        sim->lowNibble = true;
+        return;
+    }
+
+    sim->lowNibble = false;
+    uint8_t value = sim->highNibble | (nibble >> 4);
+
+    if(sim->pins & REG_SELECT_BIT)
+    {
+        _data(sim, value);
+    }
+    else
+    {
+        _instruction(sim, value);
+    }
+}
+
+/********************************
+ * Instruction table on page 24
+ ********************************/
+static void _instruction(SIM_Lcd * sim, uint8_t value)
+{
+    sim->instructions++;
+
+    if(value & LCD_SETDDRAMADDR)
+    {
+        sim->address = value & 0x7F;
+        sim->cgramSelected = false;
+        _busy(sim, EXECUTE_US);
+    }
+    else if(value & LCD_SETCGRAMADDR)
+    {
+        sim->address = value & 0x3F;
+        sim->cgramSelected = true;
+        _busy(sim, EXECUTE_US);
+    }
+    else if(value & LCD_FUNCTIONSET)
+    {
+        if(sim->eightBit && (value & 0x10))
+        {
+            // Part of the reset sequence (page 46)
+            sim->resetSets++;
+            _busy(sim, (sim->resetSets == 1) ? FIRST_RESET_US :
+                       (sim->resetSets == 2) ? SECOND_RESET_US : EXECUTE_US);
+            return;
+        }
+
+        sim->eightBit = (value & 0x10) != 0;
+        sim->lowNibble = false;
+        sim->functionSet = value;
+        _busy(sim, EXECUTE_US);
+    }
+    else if(value & LCD_CURSORSHIFT)
+    {
+        bool right = (value & LCD_MOVERIGHT) != 0;
+
+        if(value & LCD_DISPLAYMOVE)
+        {
+            sim->shift = (sim->shift + (right ? SIM_LINE_LENGTH - 1 : 1)) % SIM_LINE_LENGTH;
+        }
+        else
+        {
+            uint8_t entryMode = sim->entryMode;
+            sim->entryMode = right ? LCD_ENTRYLEFT : 0;
+            _stepAddress(sim);
+            sim->entryMode = entryMode;
+        }
+        _busy(sim, EXECUTE_US);
+    }
+    else if(value & LCD_DISPLAYCONTROL)
+    {
+        sim->displayControl = value & 0x07;
+        _busy(sim, EXECUTE_US);
+    }
+    else if(value & LCD_ENTRYMODESET)
+    {
+        sim->entryMode = value & 0x03;
+        _busy(sim, EXECUTE_US);
+    }
+    else if(value & LCD_RETURNHOME)
+    {
+        sim->address = 0;
+        sim->cgramSelected = false;
+        sim->shift = 0;
+        _busy(sim, CLEAR_HOME_US);
+    }
+    else if(value & LCD_CLEARDISPLAY)
+    {
+        memset(sim->ddram, ' ', sizeof(sim->ddram));
+        sim->address = 0;
+        sim->cgramSelected = false;
+        sim->shift = 0;
+        sim->entryMode |= LCD_ENTRYLEFT;
+        _busy(sim, CLEAR_HOME_US);
+    }
+}
+
+/********************************
+ * Write to DDRAM or CGRAM, then move the address counter
+ * and (with autoscroll) the display
+ ********************************/
+static void _data(SIM_Lcd * sim, uint8_t value)
+{
+    sim->dataWrites++;
+
+    if(sim->cgramSelected)
+    {
+        // Only the 5 low bits of a row exist
+        sim->cgram[sim->address & (SIM_CGRAM_SIZE - 1)] = value & 0x1F;
+    }
+    else
+    {
+        uint8_t row = (sim->address & ROW_ADDRESS_MASK) ? 1 : 0;
+        uint8_t col = (sim->address & ~ROW_ADDRESS_MASK) % SIM_LINE_LENGTH;
+        sim->ddram[row][col] = value;
+
+        if(sim->entryMode & LCD_ENTRYSHIFTINCREMENT)
+        {
+            bool left = (sim->entryMode & LCD_ENTRYLEFT) != 0;
+            sim->shift = (sim->shift + (left ? 1 : SIM_LINE_LENGTH - 1)) % SIM_LINE_LENGTH;
+        }
+    }
+
+    _stepAddress(sim);
+    _busy(sim, EXECUTE_US + 4);
+}
+
+/********************************/
+static void _busy(SIM_Lcd * sim, uint32_t durationUs)
+{
+    sim->busyUntilNs = sim->nowNs + (uint64_t)durationUs * 1000;
+}
+
+/********************************
+ * Increment or decrement per the entry mode. In 2 line mode
+ * DDRAM runs 0x00-0x27 then 0x40-0x67 and wraps (page 10)
+ ********************************/
+static void _stepAddress(SIM_Lcd * sim)
+{
+    bool up = (sim->entryMode & LCD_ENTRYLEFT) != 0;
+
+    if(sim->cgramSelected)
+    {
+        sim->address = (sim->address + (up ? 1 : -1)) & (SIM_CGRAM_SIZE - 1);
+        return;
+    }
+
+    uint8_t row = sim->address & ROW_ADDRESS_MASK;
+    uint8_t col = sim->address & ~ROW_ADDRESS_MASK;
+
+    if(up)
+    {
+        sim->address = (++col < SIM_LINE_LENGTH) ? (row | col) : (row ^ ROW_ADDRESS_MASK);
+    }
+    else
+    {
+        sim->address = (col > 0) ? (row | (col - 1)) :
+                           ((row ^ ROW_ADDRESS_MASK) | (SIM_LINE_LENGTH - 1));
+    }
+}
+
+/********************************
+ * Busy flag and address counter
+ ********************************/
+static uint8_t _status(SIM_Lcd * sim)
+{
+    uint8_t status = sim->address & 0x7F;
+
+    if(sim->nowNs < sim->busyUntilNs)
+    {
+        status |= 0x80;
+    }
+
+    return status;
+}
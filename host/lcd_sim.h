@@ -0,0 +1,64 @@
+/********************************
+ * lcd_sim.h
+ *
+ *  Software model of a PCF8574 backpack driving a
+ *  HD44780 16x2 LCD, for running on a PC.
+ *
+ *  Feed it the bytes i2c_lcd.c puts on the bus and it
+ *  keeps DDRAM, CGRAM, the address counter and entry
+ *  mode the way the controller would, on a virtual
+ *  clock that charges real I2C bus time.
+ *
+ ********************************/
+
+#ifndef LCD_SIM_H_
+#define LCD_SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SIM_ROWS                2
+#define SIM_COLUMNS             16
+#define SIM_LINE_LENGTH         40
+#define SIM_CGRAM_SIZE          64
+
+typedef struct SIM_Lcd
+{
+    uint32_t sclHz;                     // Bus speed time is charged at
+    uint64_t nowNs;                     // Virtual clock
+    uint64_t busyUntilNs;               // Controller busy until then
+
+    bool readWriteGrounded;             // Write only module, R/W wired to ground
+    uint32_t nackAddresses;             // Transactions left to NAK, a loose cable
+    uint32_t maxSclHz;                  // Fastest SCL it answers at, 0 for any
+    uint8_t pins;                       // Last byte written to the PCF8574
+    bool eightBit;                      // Interface width, true after reset
+    bool lowNibble;                     // Next nibble is the low one (4 bit mode)
+    uint8_t highNibble;
+    uint8_t resetSets;                  // 8 bit function sets seen so far
+
+    uint8_t ddram[SIM_ROWS][SIM_LINE_LENGTH];
+    uint8_t cgram[SIM_CGRAM_SIZE];
+    uint8_t address;                    // Address counter
+    bool cgramSelected;                 // Address counter points into CGRAM
+    uint8_t shift;                      // Display shift, columns to the left
+    uint8_t entryMode;
+    uint8_t displayControl;
+    uint8_t functionSet;
+
+    uint32_t transactions;              // START conditions
+    uint32_t bytes;                     // Bytes after the address byte
+    uint32_t instructions;              // Completed RS = 0 writes
+    uint32_t dataWrites;                // Completed RS = 1 writes
+    uint32_t violations;                // Enable edges while the controller was busy
+} SIM_Lcd;
+
+void SIM_init(SIM_Lcd * sim, uint32_t sclHz);
+void SIM_start(SIM_Lcd * sim);
+void SIM_write(SIM_Lcd * sim, uint8_t data);
+uint8_t SIM_read(SIM_Lcd * sim);
+void SIM_stop(SIM_Lcd * sim);
+void SIM_delay(SIM_Lcd * sim, uint32_t durationUs);
+void SIM_visibleRow(SIM_Lcd * sim, uint8_t row, char * text);
+
+#endif /* LCD_SIM_H_ */
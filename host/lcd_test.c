@@ -0,0 +1,956 @@
+/********************************
+ * lcd_test.c
+ *
+ *  Regression tests for i2c_lcd.c, run on a PC against
+ *  the driverlib stub and the lcd_sim.c model. Each test
+ *  powers up a fresh model and checks what ends up on
+ *  the glass, the protocol violations the model counted
+ *  and the bus time it took. Each runs in its own process,
+ *  the driver's statics (DMA and queue timer set up once)
+ *  start from zero like after an MCU reset.
+ *
+ *  make -C host test
+ *
+ ********************************/
+
+/********************************
+ * Includes
+ ********************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <driverlib.h>
+#include "driverlib_stub.h"
+#include "lcd_sim.h"
+#include "../i2c_lcd.h"
+
+/********************************
+ * File specific functions
+ ********************************/
+static void _run(uint8_t test);
+static void _powerUp(SIM_Lcd * sim, uint32_t busSpeed);
+static void _powerUpAt(SIM_Lcd * sim, uint32_t busSpeed, uint32_t clockHz);
+static uint64_t _busUs(uint32_t bits, uint32_t busSpeed);
+static void _check(bool ok, const char * test, const char * what, int line);
+static bool _rowIs(SIM_Lcd * sim, uint8_t row, const char * text);
+static void _testWriteString(void);
+static void _testTransferModes(void);
+static void _testAutoscroll(void);
+static void _testWriteOnlyBusyFlag(void);
+static void _testWriteRaw(void);
+static void _testRefreshRefused(void);
+static void _testRefreshWaitsForCalls(void);
+static void _testFractionalClock(void);
+static void _testNackResend(void);
+static void _testReinitOnRefresh(void);
+static void _testSettlePadding(void);
+static void _testRewriteSkipped(void);
+static void _testBusyFlag(void);
+static void _testRateProbe(void);
+static void _testRateProbeSlowClock(void);
+static void _testSharedBus(void);
+static void _testGlyphCache(void);
+static void _testStats(void);
+static void _testPlannerAfterShift(void);
+static void _testPlannerRightToLeft(void);
+static void _testLongMarquee(void);
+static void _testFormatters(void);
+static void _testOffScreenColumns(void);
+
+/********************************
+ * Global variables specific to file
+ ********************************/
+#define CHECK(test, ok)     _check((ok), (test), #ok, __LINE__)
+
+#define MCLK_HZ             3000000     // MSP432 reset clocks
+#define SMCLK_HZ            3000000
+#define FAST_CLOCK_HZ       12000000    // DCO setting that allows 1MHz SCL
+#define INSTRUCTION_BYTES   6           // Expander bytes per nibble pair
+#define SLAVE_ADDRESS       0x27
+#define TEST_TIMEOUT_S      20          // A test that hangs is a failure
+
+static LCD_Object _lcd;
+static int _failures;
+
+static void (* const _tests[])(void) =
+{
+    _testWriteString,
+    _testTransferModes,
+    _testAutoscroll,
+    _testWriteOnlyBusyFlag,
+    _testWriteRaw,
+    _testRefreshRefused,
+    _testRefreshWaitsForCalls,
+    _testFractionalClock,
+    _testNackResend,
+    _testReinitOnRefresh,
+    _testSettlePadding,
+    _testRewriteSkipped,
+    _testBusyFlag,
+    _testRateProbe,
+    _testRateProbeSlowClock,
+    _testSharedBus,
+    _testGlyphCache,
+    _testStats,
+    _testPlannerAfterShift,
+    _testPlannerRightToLeft,
+    _testLongMarquee,
+    _testFormatters,
+    _testOffScreenColumns
+};
+
+/********************************/
+int main(void)
+{
+    uint8_t i;
+    for(i = 0; i < sizeof(_tests) / sizeof(_tests[0]); i++)
+    {
+        _run(i);
+    }
+
+    if(_failures)
+    {
+        printf("FAIL %d\n", _failures);
+        return 1;
+    }
+
+    printf("PASS\n");
+    return 0;
+}
+
+/********************************
+ * One test in a child process, its failed checks
+ * come back as the exit status
+ ********************************/
+static void _run(uint8_t test)
+{
+    fflush(stdout);
+
+    pid_t child = fork();
+    if(child == 0)
+    {
+        _failures = 0;
+        alarm(TEST_TIMEOUT_S);
+        _tests[test]();
+        fflush(stdout);
+        _exit(_failures > 255 ? 255 : _failures);
+    }
+
+    int status;
+    if(child < 0 || waitpid(child, &status, 0) != child || !WIFEXITED(status))
+    {
+        printf("test %u: didn't finish\n", test);
+        _failures++;
+        return;
+    }
+
+    _failures += WEXITSTATUS(status);
+}
+
+/********************************
+ * Fresh MCU and a fresh display at power good, with the
+ * handlers in the vector table like the startup file has
+ ********************************/
+static void _powerUp(SIM_Lcd * sim, uint32_t busSpeed)
+{
+    STUB_reset(MCLK_HZ, SMCLK_HZ);
+    _powerUpAt(sim, busSpeed, 0);
+}
+
+/********************************
+ * The same with MCLK and SMCLK at clockHz, 0 leaves
+ * the clocks alone
+ ********************************/
+static void _powerUpAt(SIM_Lcd * sim, uint32_t busSpeed, uint32_t clockHz)
+{
+    if(clockHz)
+    {
+        STUB_reset(clockHz, clockHz);
+    }
+    SIM_init(sim, busSpeed);
+    STUB_attach(EUSCI_B0_BASE, SLAVE_ADDRESS, sim);
+
+    Interrupt_registerInterrupt(INT_EUSCIB0, LCD_i2cB0IntHandler);
+    Interrupt_registerInterrupt(INT_EUSCIB1, LCD_i2cB1IntHandler);
+    Interrupt_registerInterrupt(INT_DMA_INT1, LCD_dmaB0IntHandler);
+    Interrupt_registerInterrupt(INT_DMA_INT2, LCD_dmaB1IntHandler);
+    Interrupt_registerInterrupt(INT_T32_INT2, LCD_timerIntHandler);
+    Interrupt_registerInterrupt(INT_TA0_0, LCD_refreshIntHandler);
+}
+
+/********************************
+ * Bus time for bits at busSpeed, the model charges
+ * 9 per byte and one each for START and STOP
+ ********************************/
+static uint64_t _busUs(uint32_t bits, uint32_t busSpeed)
+{
+    return ((uint64_t)bits * 1000000) / busSpeed;
+}
+
+/********************************/
+static void _check(bool ok, const char * test, const char * what, int line)
+{
+    if(!ok)
+    {
+        printf("%s: line %d: %s\n", test, line, what);
+        _failures++;
+    }
+}
+
+/********************************/
+static bool _rowIs(SIM_Lcd * sim, uint8_t row, const char * text)
+{
+    char visible[SIM_COLUMNS + 1];
+    SIM_visibleRow(sim, row, visible);
+
+    return strcmp(visible, text) == 0;
+}
+
+/********************************
+ * Five characters at 100kHz go out in one transaction:
+ * each is two nibbles of three expander bytes (set up,
+ * E high, E low), 30 bytes. The 37us settle is shorter
+ * than a byte time so nothing pads it, that makes
+ * START + address (10 bits) + 30 * 9 bits + STOP (1 bit)
+ * = 281 bits, 2810us.
+ ********************************/
+static void _testWriteString(void)
+{
+    const char * test = "writeString";
+    SIM_Lcd sim;
+
+    _powerUp(&sim, LCD_I2C_STANDARD);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_STANDARD));
+    CHECK(test, _rowIs(&sim, 0, "                "));
+
+    uint32_t transactions = sim.transactions;
+    uint64_t start = STUB_nowNs();
+    LCD_writeString(&_lcd, (uint8_t *)"Hello", 5);
+    uint64_t elapsedUs = (STUB_nowNs() - start) / 1000;
+
+    CHECK(test, memcmp(sim.ddram[0], "Hello ", 6) == 0);
+    CHECK(test, _rowIs(&sim, 0, "Hello           "));
+    CHECK(test, sim.address == 5);
+    CHECK(test, sim.transactions - transactions == 1);
+    CHECK(test, elapsedUs >= _busUs(281, LCD_I2C_STANDARD));
+    CHECK(test, elapsedUs <= _busUs(281, LCD_I2C_STANDARD) + 5);
+    CHECK(test, sim.violations == 0);
+}
+
+/********************************
+ * DMA and queued mode end up with the same screen as
+ * blocking mode. At 400kHz the two bytes to the next
+ * enable edge cover the 37us settle, at 1MHz it has to
+ * be padded out with three more.
+ ********************************/
+static void _testTransferModes(void)
+{
+    const char * test = "transferModes";
+    const uint8_t modes[] = { LCD_TRANSFER_BLOCKING, LCD_TRANSFER_DMA, LCD_TRANSFER_QUEUED };
+    const uint32_t speeds[] = { LCD_I2C_FAST, LCD_I2C_FAST_PLUS };
+    SIM_Lcd sim;
+
+    _powerUpAt(&sim, LCD_I2C_FAST, FAST_CLOCK_HZ);
+
+    uint8_t i;
+    for(i = 0; i < sizeof(modes) * 2; i++)
+    {
+        uint32_t speed = speeds[i / sizeof(modes)];
+        SIM_init(&sim, speed);
+        CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, speed));
+        LCD_setTransferMode(&_lcd, modes[i % sizeof(modes)]);
+
+        LCD_writeString(&_lcd, (uint8_t *)"Transfer mode", 13);
+        LCD_setCursorPosition(&_lcd, 1, 3);
+        LCD_writeInt(&_lcd, -42, 4);
+        LCD_waitIdle(&_lcd);
+        CHECK(test, _rowIs(&sim, 0, "Transfer mode   "));
+        CHECK(test, _rowIs(&sim, 1, "    -42         "));
+
+        LCD_clear(&_lcd);
+        LCD_writeString(&_lcd, (uint8_t *)"Again", 5);
+        LCD_waitIdle(&_lcd);
+
+        CHECK(test, _rowIs(&sim, 0, "Again           "));
+        CHECK(test, _rowIs(&sim, 1, "                "));
+        CHECK(test, !LCD_isBusy(&_lcd));
+        CHECK(test, sim.violations == 0);
+
+        LCD_setTransferMode(&_lcd, LCD_TRANSFER_BLOCKING);
+    }
+}
+
+/********************************
+ * With autoscroll on every data write shifts the
+ * display, moving the cursor one cell mustn't be done
+ * by rewriting the cell in between
+ ********************************/
+static void _testAutoscroll(void)
+{
+    const char * test = "autoscroll";
+    SIM_Lcd sim;
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+
+    LCD_writeString(&_lcd, (uint8_t *)"ab", 2);
+    LCD_autoscrollOn(&_lcd);
+    LCD_setCursorPosition(&_lcd, 0, 3);
+    CHECK(test, sim.shift == 0);
+
+    LCD_writeChar(&_lcd, 'c');
+    CHECK(test, sim.shift == 1);
+    CHECK(test, sim.ddram[0][2] == ' ' && sim.ddram[0][3] == 'c');
+    CHECK(test, _lcd.displayShift == sim.shift);
+    CHECK(test, sim.violations == 0);
+}
+
+/********************************
+ * A module with R/W tied low reads back 0xFF, which the
+ * controller takes as SETDDRAMADDR 0x7F. The probe has to
+ * fail and the next write still land at the cursor.
+ ********************************/
+static void _testWriteOnlyBusyFlag(void)
+{
+    const char * test = "writeOnlyBusyFlag";
+    SIM_Lcd sim;
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    sim.readWriteGrounded = true;
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+
+    LCD_setCursorPosition(&_lcd, 1, 2);
+    CHECK(test, !LCD_setTimingMode(&_lcd, LCD_TIMING_BUSYFLAG));
+    CHECK(test, _lcd.timingMode == LCD_TIMING_FIXED);
+
+    LCD_writeString(&_lcd, (uint8_t *)"ok", 2);
+    CHECK(test, _rowIs(&sim, 1, "  ok            "));
+    CHECK(test, sim.violations == 0);
+}
+
+/********************************
+ * Raw text has no glyph escape, every byte is a
+ * character code
+ ********************************/
+static void _testWriteRaw(void)
+{
+    const char * test = "writeRaw";
+    SIM_Lcd sim;
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+
+    const uint8_t text[] = { 'a', LCD_GLYPH_ESCAPE, 0x02, 'b' };
+    LCD_writeRaw(&_lcd, text, sizeof(text));
+
+    CHECK(test, memcmp(sim.ddram[0], text, sizeof(text)) == 0);
+    CHECK(test, sim.address == sizeof(text));
+    CHECK(test, sim.violations == 0);
+}
+
+/********************************
+ * The refresh can't wait on the bus from its interrupt
+ * or write into a display that autoscrolls
+ ********************************/
+static void _testRefreshRefused(void)
+{
+    const char * test = "refreshRefused";
+    SIM_Lcd sim;
+    LCD_Field field;
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+
+    CHECK(test, !LCD_fbStart(&_lcd, 50));
+    CHECK(test, !LCD_fieldInit(&_lcd, &field, 1, 0, 4, NULL, 10));
+
+    LCD_setTransferMode(&_lcd, LCD_TRANSFER_QUEUED);
+    LCD_autoscrollOn(&_lcd);
+    CHECK(test, !LCD_fbStart(&_lcd, 50));
+    CHECK(test, !LCD_fieldInit(&_lcd, &field, 1, 0, 4, NULL, 10));
+    CHECK(test, !_lcd.fbRunning && !_lcd.fields);
+
+    LCD_setTransferMode(&_lcd, LCD_TRANSFER_BLOCKING);
+}
+
+/********************************
+ * A refresh tick that lands while a call is filling
+ * txBuffer leaves the display for the next tick. Labels
+ * written next to a running field stay put.
+ ********************************/
+static void _testRefreshWaitsForCalls(void)
+{
+    const char * test = "refreshWaitsForCalls";
+    SIM_Lcd sim;
+    LCD_Field field;
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+    LCD_setTransferMode(&_lcd, LCD_TRANSFER_QUEUED);
+
+    CHECK(test, LCD_fbStart(&_lcd, 50));
+    memcpy(LCD_framebuffer(&_lcd)[0], "Frame", 5);
+    LCD_commit(&_lcd);
+
+    // As if the tick came in the middle of a call
+    _lcd.inCall++;
+    STUB_advance(40000);
+    CHECK(test, _rowIs(&sim, 0, "                "));
+
+    _lcd.inCall--;
+    STUB_advance(40000);
+    CHECK(test, _rowIs(&sim, 0, "Frame           "));
+    LCD_fbStop(&_lcd);
+
+    CHECK(test, LCD_fieldInit(&_lcd, &field, 1, 12, 4, NULL, 50));
+    LCD_fieldSet(&field, 1234);
+    LCD_setCursorPosition(&_lcd, 1, 0);
+    LCD_writeString(&_lcd, (uint8_t *)"RPM", 3);
+    STUB_advance(40000);
+    CHECK(test, _rowIs(&sim, 1, "RPM         1234"));
+    LCD_fieldRemove(&_lcd, &field);
+
+    LCD_waitIdle(&_lcd);
+    CHECK(test, _lcd.inCall == 0);
+    CHECK(test, sim.violations == 0);
+
+    LCD_setTransferMode(&_lcd, LCD_TRANSFER_BLOCKING);
+}
+
+/********************************
+ * At the 1.5MHz DCO setting a microsecond is 1.5 ticks,
+ * delays must round up or power up comes in under 40ms
+ ********************************/
+static void _testFractionalClock(void)
+{
+    const char * test = "fractionalClock";
+    SIM_Lcd sim;
+
+    _powerUpAt(&sim, LCD_I2C_STANDARD, 1500000);
+
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_STANDARD));
+    LCD_clear(&_lcd);
+    LCD_writeString(&_lcd, (uint8_t *)"1.5MHz", 6);
+
+    CHECK(test, _rowIs(&sim, 0, "1.5MHz          "));
+    CHECK(test, sim.violations == 0);
+}
+
+/********************************
+ * Bytes lost to a NACK never reached the LCD, the shadow
+ * can't be trusted to skip cells or plan a clear with
+ ********************************/
+static void _testNackResend(void)
+{
+    const char * test = "nackResend";
+    SIM_Lcd sim;
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+
+    // Hidden cursor, the seek and the text go out together
+    LCD_cursorOff(&_lcd);
+    LCD_blinkOff(&_lcd);
+    LCD_writeString(&_lcd, (uint8_t *)"Hello", 5);
+    sim.nackAddresses = 1;
+    LCD_setCursorPosition(&_lcd, 0, 0);
+    LCD_writeString(&_lcd, (uint8_t *)"Jello", 5);
+    CHECK(test, _rowIs(&sim, 0, "Hello           "));
+    CHECK(test, _lcd.stats.nacks == 1);
+
+    // Same text again, this time it has to go out
+    LCD_setCursorPosition(&_lcd, 0, 0);
+    LCD_writeString(&_lcd, (uint8_t *)"Jello", 5);
+    CHECK(test, _rowIs(&sim, 0, "Jello           "));
+
+    // A planned clear that was lost leaves a blank shadow
+    sim.nackAddresses = 1;
+    LCD_clear(&_lcd);
+    CHECK(test, _rowIs(&sim, 0, "Jello           "));
+    LCD_clear(&_lcd);
+    CHECK(test, _rowIs(&sim, 0, "                "));
+
+    LCD_writeString(&_lcd, (uint8_t *)"ok", 2);
+    CHECK(test, _rowIs(&sim, 0, "ok              "));
+    CHECK(test, sim.violations == 0);
+}
+
+/********************************
+ * LCD_init again on a display the refresh serves takes
+ * it off the refresh list, the display after it on the
+ * list keeps being refreshed
+ ********************************/
+static void _testReinitOnRefresh(void)
+{
+    const char * test = "reinitOnRefresh";
+    SIM_Lcd sim;
+    SIM_Lcd otherSim;
+    LCD_Object other;
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    SIM_init(&otherSim, LCD_I2C_FAST);
+    STUB_attach(EUSCI_B0_BASE, SLAVE_ADDRESS - 1, &otherSim);
+    CHECK(test, LCD_init(&other, EUSCI_B0_BASE, SLAVE_ADDRESS - 1, LCD_I2C_FAST));
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+    LCD_setTransferMode(&_lcd, LCD_TRANSFER_QUEUED);
+
+    // _lcd goes on the list last, so it is at the head
+    CHECK(test, LCD_fbStart(&other, 50));
+    CHECK(test, LCD_fbStart(&_lcd, 50));
+
+    // LCD_init wants the bus in blocking mode, the refresh sits it out
+    LCD_setTransferMode(&_lcd, LCD_TRANSFER_BLOCKING);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+    CHECK(test, !_lcd.fbRunning);
+    LCD_setTransferMode(&_lcd, LCD_TRANSFER_QUEUED);
+
+    memcpy(LCD_framebuffer(&other)[1], "still here", 10);
+    LCD_commit(&other);
+    STUB_advance(40000);
+    CHECK(test, _rowIs(&otherSim, 1, "still here      "));
+    CHECK(test, otherSim.violations == 0 && sim.violations == 0);
+}
+
+/********************************
+ * At 1MHz an instruction is its 6 bytes plus 3 idle
+ * ones, 9 bytes of 9us: the next enable edge is 5 bytes
+ * (45us) after the last, past the 37us settle
+ ********************************/
+static void _testSettlePadding(void)
+{
+    const char * test = "settlePadding";
+    SIM_Lcd sim;
+
+    _powerUpAt(&sim, LCD_I2C_FAST_PLUS, FAST_CLOCK_HZ);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST_PLUS));
+    CHECK(test, LCD_getBusSpeed(&_lcd) == LCD_I2C_FAST_PLUS);
+    LCD_cursorOff(&_lcd);
+    LCD_blinkOff(&_lcd);
+
+    uint32_t bytes = sim.bytes;
+    LCD_writeString(&_lcd, (uint8_t *)"Pad", 3);
+
+    CHECK(test, sim.bytes - bytes == 3 * 9);
+    CHECK(test, _rowIs(&sim, 0, "Pad             "));
+    CHECK(test, sim.violations == 0);
+}
+
+/********************************
+ * Cells that already show the character cost nothing,
+ * only the changed one goes out (with its set address)
+ ********************************/
+static void _testRewriteSkipped(void)
+{
+    const char * test = "rewriteSkipped";
+    SIM_Lcd sim;
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+    LCD_cursorOff(&_lcd);
+    LCD_blinkOff(&_lcd);
+    LCD_writeString(&_lcd, (uint8_t *)"Speed 100", 9);
+
+    uint32_t bytes = sim.bytes;
+    uint32_t transactions = sim.transactions;
+    LCD_setCursorPosition(&_lcd, 0, 0);
+    LCD_writeString(&_lcd, (uint8_t *)"Speed 100", 9);
+    CHECK(test, sim.bytes == bytes);
+    CHECK(test, sim.transactions == transactions);
+
+    LCD_setCursorPosition(&_lcd, 0, 0);
+    LCD_writeString(&_lcd, (uint8_t *)"Speed 105", 9);
+    CHECK(test, sim.bytes - bytes == 2 * INSTRUCTION_BYTES);
+    CHECK(test, _rowIs(&sim, 0, "Speed 105       "));
+    CHECK(test, sim.violations == 0);
+}
+
+/********************************
+ * With R/W wired the busy flag is read back, a clear
+ * waits the 1.52ms it takes instead of the fixed 4.5ms
+ ********************************/
+static void _testBusyFlag(void)
+{
+    const char * test = "busyFlag";
+    SIM_Lcd sim;
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+    CHECK(test, LCD_setTimingMode(&_lcd, LCD_TIMING_BUSYFLAG));
+    CHECK(test, _lcd.timingMode == LCD_TIMING_BUSYFLAG);
+
+    LCD_writeString(&_lcd, (uint8_t *)"Busy flag test, the whole line!!", 32);
+
+    uint64_t start = STUB_nowNs();
+    LCD_clear(&_lcd);
+    uint64_t clearUs = (STUB_nowNs() - start) / 1000;
+    CHECK(test, clearUs >= 1520 && clearUs < 4500);
+
+    LCD_writeString(&_lcd, (uint8_t *)"ok", 2);
+    CHECK(test, _rowIs(&sim, 0, "ok              "));
+    CHECK(test, _rowIs(&sim, 1, "                "));
+    CHECK(test, sim.violations == 0);
+}
+
+/********************************
+ * LCD_I2C_PROBE takes the fastest rate SMCLK allows
+ * that the expander answers at every time. A second
+ * display that can't keep up slows the shared bus.
+ ********************************/
+static void _testRateProbe(void)
+{
+    const char * test = "rateProbe";
+    SIM_Lcd sim;
+    SIM_Lcd slowSim;
+    LCD_Object slow;
+
+    _powerUpAt(&sim, LCD_I2C_STANDARD, FAST_CLOCK_HZ);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_PROBE));
+    CHECK(test, LCD_getBusSpeed(&_lcd) == LCD_I2C_FAST_PLUS);
+    CHECK(test, _lcd.stats.nacks == 0);
+
+    SIM_init(&slowSim, LCD_I2C_STANDARD);
+    slowSim.maxSclHz = LCD_I2C_STANDARD;
+    STUB_attach(EUSCI_B0_BASE, SLAVE_ADDRESS - 1, &slowSim);
+    CHECK(test, LCD_init(&slow, EUSCI_B0_BASE, SLAVE_ADDRESS - 1, LCD_I2C_PROBE));
+    CHECK(test, LCD_getBusSpeed(&slow) == LCD_I2C_STANDARD);
+    CHECK(test, LCD_getBusSpeed(&_lcd) == LCD_I2C_STANDARD);
+    CHECK(test, slow.stats.nacks > 0);
+
+    LCD_writeString(&_lcd, (uint8_t *)"Probed", 6);
+    LCD_writeString(&slow, (uint8_t *)"Slow", 4);
+    CHECK(test, _rowIs(&sim, 0, "Probed          "));
+    CHECK(test, _rowIs(&slowSim, 0, "Slow            "));
+    CHECK(test, sim.violations == 0 && slowSim.violations == 0);
+}
+
+/********************************
+ * At the 3MHz reset SMCLK 1MHz is out of reach, and
+ * an expander that answers at no rate fails init
+ ********************************/
+static void _testRateProbeSlowClock(void)
+{
+    const char * test = "rateProbeSlowClock";
+    SIM_Lcd sim;
+    SIM_Lcd deadSim;
+    LCD_Object dead;
+
+    _powerUp(&sim, LCD_I2C_STANDARD);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_PROBE));
+    CHECK(test, LCD_getBusSpeed(&_lcd) == LCD_I2C_FAST);
+
+    SIM_init(&deadSim, LCD_I2C_STANDARD);
+    deadSim.maxSclHz = LCD_I2C_STANDARD / 2;
+    STUB_attach(EUSCI_B0_BASE, SLAVE_ADDRESS - 1, &deadSim);
+    CHECK(test, !LCD_init(&dead, EUSCI_B0_BASE, SLAVE_ADDRESS - 1, LCD_I2C_PROBE));
+
+    LCD_writeString(&_lcd, (uint8_t *)"Still here", 10);
+    CHECK(test, _rowIs(&sim, 0, "Still here      "));
+    CHECK(test, sim.violations == 0);
+}
+
+/********************************
+ * Two displays on one bus, calls interleaved, in each
+ * transfer mode: each screen gets only its own text
+ ********************************/
+static void _testSharedBus(void)
+{
+    const char * test = "sharedBus";
+    const uint8_t modes[] = { LCD_TRANSFER_BLOCKING, LCD_TRANSFER_DMA, LCD_TRANSFER_QUEUED };
+    SIM_Lcd sim;
+    SIM_Lcd otherSim;
+    LCD_Object other;
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    SIM_init(&otherSim, LCD_I2C_FAST);
+    STUB_attach(EUSCI_B0_BASE, SLAVE_ADDRESS - 1, &otherSim);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+    CHECK(test, LCD_init(&other, EUSCI_B0_BASE, SLAVE_ADDRESS - 1, LCD_I2C_FAST));
+
+    uint8_t i;
+    for(i = 0; i < sizeof(modes); i++)
+    {
+        LCD_setTransferMode(&_lcd, modes[i]);
+
+        LCD_setCursorPosition(&_lcd, 0, 0);
+        LCD_setCursorPosition(&other, 0, 0);
+        LCD_writeString(&_lcd, (uint8_t *)"first ", 6);
+        LCD_writeString(&other, (uint8_t *)"second ", 7);
+        LCD_writeInt(&_lcd, i, 0);
+        LCD_writeInt(&other, i, 0);
+        LCD_setCursorPosition(&_lcd, 1, 0);
+        LCD_writeString(&_lcd, (uint8_t *)"bottom", 6);
+        LCD_waitIdle(&_lcd);
+        LCD_waitIdle(&other);
+    }
+
+    CHECK(test, _rowIs(&sim, 0, "first 2         "));
+    CHECK(test, _rowIs(&sim, 1, "bottom          "));
+    CHECK(test, _rowIs(&otherSim, 0, "second 2        "));
+    CHECK(test, _rowIs(&otherSim, 1, "                "));
+    CHECK(test, sim.violations == 0 && otherSim.violations == 0);
+
+    LCD_setTransferMode(&_lcd, LCD_TRANSFER_BLOCKING);
+}
+
+/********************************
+ * Ten glyphs through eight slots: the least recently
+ * used one that isn't on screen is evicted, and with
+ * every slot showing LCD_GLYPH_MISSING is drawn instead
+ ********************************/
+static void _testGlyphCache(void)
+{
+    const char * test = "glyphCache";
+    uint8_t glyphs[10][CHAR_HEIGHT];
+    SIM_Lcd sim;
+
+    uint8_t id;
+    for(id = 0; id < 10; id++)
+    {
+        memset(glyphs[id], id + 1, CHAR_HEIGHT);
+    }
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+    CHECK(test, LCD_setGlyphTable(&_lcd, (const uint8_t (*)[CHAR_HEIGHT])glyphs, 10));
+
+    // Glyphs 0-7 fill the slots in order
+    for(id = 0; id < 8; id++)
+    {
+        CHECK(test, LCD_writeGlyph(&_lcd, id));
+    }
+
+    // 0, 1 and 2 leave the screen, then 1 is used again
+    LCD_setCursorPosition(&_lcd, 0, 0);
+    LCD_writeString(&_lcd, (uint8_t *)"   ", 3);
+    LCD_setCursorPosition(&_lcd, 1, 15);
+    LCD_writeGlyph(&_lcd, 1);
+    LCD_setCursorPosition(&_lcd, 1, 15);
+    LCD_writeChar(&_lcd, ' ');
+
+    // 8 replaces 0, the oldest off screen, 9 then replaces 2
+    LCD_setCursorPosition(&_lcd, 1, 0);
+    LCD_writeGlyph(&_lcd, 8);
+    LCD_writeGlyph(&_lcd, 9);
+    CHECK(test, (sim.ddram[1][0] & 0x07) == 0 && sim.cgram[0] == 9);
+    CHECK(test, (sim.ddram[1][1] & 0x07) == 2 && sim.cgram[2 * CHAR_HEIGHT] == 10);
+    CHECK(test, sim.cgram[1 * CHAR_HEIGHT] == 2);
+
+    // 0 takes the last free slot, then there is none for 1
+    LCD_writeGlyph(&_lcd, 0);
+    CHECK(test, (sim.ddram[1][2] & 0x07) == 1 && sim.cgram[1 * CHAR_HEIGHT] == 1);
+    LCD_writeGlyph(&_lcd, 1);
+    CHECK(test, sim.ddram[1][3] == LCD_GLYPH_MISSING);
+
+    // An ID that was never registered
+    CHECK(test, !LCD_writeGlyph(&_lcd, 10));
+    CHECK(test, sim.ddram[1][4] == LCD_GLYPH_MISSING);
+    CHECK(test, sim.violations == 0);
+}
+
+/********************************
+ * The counters agree with what the model saw
+ ********************************/
+static void _testStats(void)
+{
+    const char * test = "stats";
+    SIM_Lcd sim;
+    LCD_Stats stats;
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+    LCD_cursorOff(&_lcd);
+    LCD_blinkOff(&_lcd);
+
+    LCD_resetStats(&_lcd);
+    uint32_t bytes = sim.bytes;
+    uint32_t transactions = sim.transactions;
+
+    LCD_setCursorPosition(&_lcd, 1, 4);
+    LCD_writeString(&_lcd, (uint8_t *)"abc", 3);
+    LCD_backlightOff(&_lcd);
+
+    LCD_getStats(&_lcd, &stats);
+    CHECK(test, stats.data == 3);
+    CHECK(test, stats.commands == 1);
+    CHECK(test, stats.bytes == 4 * INSTRUCTION_BYTES + 1);
+    CHECK(test, stats.bytes == sim.bytes - bytes);
+    CHECK(test, stats.transactions == sim.transactions - transactions);
+    CHECK(test, stats.nacks == 0);
+
+    LCD_resetStats(&_lcd);
+    LCD_getStats(&_lcd, &stats);
+    CHECK(test, stats.bytes == 0 && stats.transactions == 0 && stats.data == 0);
+}
+
+/********************************
+ * Home after shifting the display undoes the shift with
+ * shift instructions, clear blanks the few dirty cells:
+ * both well under the 4.5ms the commands would cost, and
+ * the model ends up as the real commands would leave it
+ ********************************/
+static void _testPlannerAfterShift(void)
+{
+    const char * test = "plannerAfterShift";
+    SIM_Lcd sim;
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+    LCD_writeString(&_lcd, (uint8_t *)"Shifted", 7);
+    LCD_shiftDisplayLeft(&_lcd);
+    LCD_shiftDisplayLeft(&_lcd);
+    CHECK(test, _rowIs(&sim, 0, "ifted           "));
+
+    uint64_t start = STUB_nowNs();
+    LCD_home(&_lcd);
+    CHECK(test, (STUB_nowNs() - start) / 1000 < 4500);
+    CHECK(test, sim.shift == 0 && sim.address == 0);
+    CHECK(test, _rowIs(&sim, 0, "Shifted         "));
+
+    LCD_shiftDisplayRight(&_lcd);
+    start = STUB_nowNs();
+    LCD_clear(&_lcd);
+    CHECK(test, (STUB_nowNs() - start) / 1000 < 4500);
+    CHECK(test, sim.shift == 0 && sim.address == 0);
+    CHECK(test, _rowIs(&sim, 0, "                "));
+
+    LCD_writeString(&_lcd, (uint8_t *)"Home", 4);
+    CHECK(test, _rowIs(&sim, 0, "Home            "));
+    CHECK(test, sim.violations == 0);
+}
+
+/********************************
+ * Right to left the cursor walks backwards, a planned
+ * clear has to leave it at 0 still going right to left
+ ********************************/
+static void _testPlannerRightToLeft(void)
+{
+    const char * test = "plannerRightToLeft";
+    SIM_Lcd sim;
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+    LCD_textRightToLeft(&_lcd);
+    LCD_setCursorPosition(&_lcd, 0, 15);
+    LCD_writeString(&_lcd, (uint8_t *)"olleh", 5);
+    CHECK(test, _rowIs(&sim, 0, "           hello"));
+
+    uint64_t start = STUB_nowNs();
+    LCD_clear(&_lcd);
+    CHECK(test, (STUB_nowNs() - start) / 1000 < 4500);
+    CHECK(test, _rowIs(&sim, 0, "                "));
+    CHECK(test, sim.address == 0 && !(sim.entryMode & LCD_ENTRYLEFT));
+
+    LCD_setCursorPosition(&_lcd, 1, 2);
+    LCD_writeString(&_lcd, (uint8_t *)"ba", 2);
+    CHECK(test, _rowIs(&sim, 1, " ab             "));
+    CHECK(test, sim.violations == 0);
+}
+
+/********************************
+ * 50 characters go round as text plus a screen of
+ * blanks, 66 steps a lap, fed in one column at a time
+ ********************************/
+static void _testLongMarquee(void)
+{
+    const char * test = "longMarquee";
+    const char * text = "The quick brown fox jumps over the lazy dog 123456";
+    const uint16_t length = 50;
+    const uint16_t period = 50 + 16;
+    const uint16_t checks[] = { 0, 1, 30, 40, 45, 60, 66, 100 };
+    SIM_Lcd sim;
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+    CHECK(test, LCD_marqueeStart(&_lcd, 0, (const uint8_t *)text, length));
+
+    uint16_t step = 0;
+    uint8_t i;
+    for(i = 0; i < sizeof(checks) / sizeof(checks[0]); i++)
+    {
+        while(step < checks[i])
+        {
+            LCD_marqueeStep(&_lcd);
+            step++;
+        }
+
+        char expected[SIM_COLUMNS + 1];
+        uint8_t col;
+        for(col = 0; col < SIM_COLUMNS; col++)
+        {
+            uint16_t index = (step + col) % period;
+            expected[col] = (index < length) ? text[index] : ' ';
+        }
+        expected[SIM_COLUMNS] = '\0';
+
+        CHECK(test, _rowIs(&sim, 0, expected));
+    }
+
+    CHECK(test, sim.violations == 0);
+}
+
+/********************************
+ * Numbers keep their width, overflow shows as '#'
+ ********************************/
+static void _testFormatters(void)
+{
+    const char * test = "formatters";
+    SIM_Lcd sim;
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+
+    LCD_writeInt(&_lcd, -42, 4);
+    LCD_writeFixed(&_lcd, 2345, 2, 6);
+    LCD_writeHex(&_lcd, 0xBEEF, 6);
+    CHECK(test, _rowIs(&sim, 0, " -42 23.4500BEEF"));
+
+    LCD_setCursorPosition(&_lcd, 1, 0);
+    LCD_writeInt(&_lcd, 12345, 3);
+    LCD_writeFixed(&_lcd, -5, 2, 0);
+    LCD_writeInt(&_lcd, 0, 0);
+    LCD_writeHex(&_lcd, 0x1F, 0);
+    CHECK(test, _rowIs(&sim, 1, "###-0.0501F     "));
+
+    LCD_clear(&_lcd);
+    CHECK(test, LCD_printf(&_lcd, "T%4d RPM%05u", -7, 42));
+    LCD_setCursorPosition(&_lcd, 1, 0);
+    CHECK(test, LCD_printf(&_lcd, "%x %c%% %3s %.1d", 255, 'z', "ab", 314));
+    CHECK(test, _rowIs(&sim, 0, "T  -7 RPM00042  "));
+    CHECK(test, _rowIs(&sim, 1, "ff z%  ab 31.4  "));
+
+    CHECK(test, !LCD_printf(&_lcd, "%f", 1));
+    CHECK(test, sim.violations == 0);
+}
+
+/********************************
+ * The cursor goes anywhere in the 40 column DDRAM line,
+ * text written past the screen shows once shifted in
+ ********************************/
+static void _testOffScreenColumns(void)
+{
+    const char * test = "offScreenColumns";
+    SIM_Lcd sim;
+
+    _powerUp(&sim, LCD_I2C_FAST);
+    CHECK(test, LCD_init(&_lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_FAST));
+    CHECK(test, !LCD_setCursorPosition(&_lcd, 0, LCD_LINE_LENGTH));
+    CHECK(test, !LCD_setCursorPosition(&_lcd, LCD_ROWS, 0));
+
+    CHECK(test, LCD_setCursorPosition(&_lcd, 1, 20));
+    LCD_writeString(&_lcd, (uint8_t *)"hidden", 6);
+    CHECK(test, _rowIs(&sim, 1, "                "));
+
+    uint8_t i;
+    for(i = 0; i < 20; i++)
+    {
+        LCD_shiftDisplayLeft(&_lcd);
+    }
+    CHECK(test, _rowIs(&sim, 1, "hidden          "));
+
+    CHECK(test, LCD_setCursorPosition(&_lcd, 0, LCD_LINE_LENGTH - 1));
+    LCD_writeChar(&_lcd, '>');
+    CHECK(test, sim.ddram[0][LCD_LINE_LENGTH - 1] == '>');
+    CHECK(test, sim.violations == 0);
+}
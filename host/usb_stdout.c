@@ -0,0 +1,41 @@
+/********************************
+ * usb_stdout.c
+ *
+ *  The USB_send* calls src/bench.c reports with, printed
+ *  to stdout for the host build
+ *
+ ********************************/
+
+/********************************
+ * Includes
+ ********************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "usb.h"
+
+/********************************/
+void USB_sendBuffer(uint8_t * bufferToSend, uint8_t numChars)
+{
+    fwrite(bufferToSend, 1, numChars, stdout);
+}
+
+/********************************
+ * The UART sends CR LF, a terminal only wants LF
+ ********************************/
+void USB_sendString(const char * string)
+{
+    for(; *string; string++)
+    {
+        if(*string != '\r')
+        {
+            putchar(*string);
+        }
+    }
+}
+
+/********************************/
+void USB_sendNumber(uint32_t value)
+{
+    printf("%u", (unsigned)value);
+}
@@ -23,434 +23,3379 @@
  *            |                 |  |       |                 |
  *            |     P1.7/UCB0SCL|<-+------>|SCL              |
  *            |                 |          |                 |
+ *
+ *  Several displays can share a bus (one slave address
+ *  each), and EUSCI_B1 on P6.4/P6.5 works the same way.
  ****************************************************************/
 
-// SET THIS TO THE CORRECT CLOCK FREQUENCY
-// Defaulted to 3MHz (MSP432 default)
-#define CLOCK_FREQ  3000000
-
 /********************************
  * Includes
  ********************************/
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdarg.h>
 #include <assert.h>
+#include <string.h>
 #include <driverlib.h>
 #include "i2c_lcd.h"
 
+/********************************
+ * Bus state
+ *
+ * Everything that belongs to an EUSCI_B module rather than
+ * a display: SCL rate, transfer mode, which display owns the
+ * transaction in flight, and the displays hanging off it.
+ ********************************/
+typedef struct LCD_Bus
+{
+    uint32_t base;                      // EUSCI_Bx_BASE
+    uint_fast8_t port;                  // SDA/SCL port
+    uint_fast16_t pins;                 // SDA/SCL pins
+    uint32_t interrupt;                 // INT_EUSCIBx
+    uint32_t dmaChannel;                // DMA_CHx_EUSCIBxTX0
+    uint32_t dmaChannelNum;
+    uint32_t dmaInterrupt;              // DMA_INTx the channel is routed to
+    uint32_t dmaIntNum;                 // INT_DMA_INTx
+
+    eUSCI_I2C_MasterConfig config;      // Clock and data rate are filled in at runtime
+
+    LCD_Handle displays;                // Every display on this bus
+    LCD_Handle cursor;                  // Round robin position in queued mode
+    LCD_Handle active;                  // Display the current transaction belongs to
+
+    uint8_t transferMode;               // LCD_TRANSFER_BLOCKING, _DMA or _QUEUED
+    bool dmaReady;                      // DMA channel set up
+    volatile bool busy;                 // Transaction in flight
+    uint16_t burstCount;                // Bytes sent in this queued transaction
+
+    uint8_t settleBytes;                // Idle bytes needed after each instruction
+    uint32_t byteTicks;                 // TIMER32_0 ticks per expander byte
+} LCD_Bus;
+
+#define BUS_COUNT           2
+
+static LCD_Bus _buses[BUS_COUNT] =
+{
+    {
+        EUSCI_B0_BASE, GPIO_PORT_P1, GPIO_PIN6 + GPIO_PIN7, INT_EUSCIB0,
+        DMA_CH0_EUSCIB0TX0, 0, DMA_INT1, INT_DMA_INT1,
+        {
+            EUSCI_B_I2C_CLOCKSOURCE_SMCLK,  // SMCLK Clock Source
+            3000000,                        // SMCLK, see _clockInit()
+            LCD_I2C_STANDARD,               // Desired I2C Clock
+            0,                              // No byte counter threshold
+            EUSCI_B_I2C_NO_AUTO_STOP        // No Autostop
+        },
+        NULL, NULL, NULL,                   // No displays yet
+        LCD_TRANSFER_BLOCKING, false, false, 0,
+        0, 0                                // Timing is set with the rate
+    },
+    {
+        EUSCI_B1_BASE, GPIO_PORT_P6, GPIO_PIN4 + GPIO_PIN5, INT_EUSCIB1,
+        DMA_CH2_EUSCIB1TX0, 2, DMA_INT2, INT_DMA_INT2,
+        {
+            EUSCI_B_I2C_CLOCKSOURCE_SMCLK,
+            3000000,
+            LCD_I2C_STANDARD,
+            0,
+            EUSCI_B_I2C_NO_AUTO_STOP
+        },
+        NULL, NULL, NULL,
+        LCD_TRANSFER_BLOCKING, false, false, 0,
+        0, 0
+    }
+};
+
 /********************************
  * File specific functions
  ********************************/
+static LCD_Bus * _busFor(uint32_t moduleInstance);
+static void _busAttach(LCD_Bus * bus, LCD_Handle lcd);
+static void _busWaitIdle(LCD_Bus * bus);
+static int _clockInit(void);
 static void _delayInit(void);
 static void _delayMicroseconds(uint32_t durationUs);
-static void _i2cInit(uint8_t slaveAddress);
-static void _command(uint8_t value);
-static void _send(uint8_t value, uint8_t mode);
-static void _write4bits(uint8_t value);
-static void _expanderWrite(uint8_t _data);
-static void _pulseEnable(uint8_t _data);
+static uint32_t _now(void);
+static uint32_t _usToTicks(uint32_t durationUs);
+static void _timingInit(LCD_Bus * bus);
+static void _settle(LCD_Handle lcd, uint32_t durationUs);
+static void _padSettle(LCD_Handle lcd, uint8_t data);
+static int _i2cInit(LCD_Handle lcd, uint32_t busSpeed);
+static int _i2cSetRate(LCD_Bus * bus, uint32_t busSpeed);
+static int _i2cProbeRate(LCD_Handle lcd, uint32_t maxSpeed);
+static bool _expanderCheck(LCD_Handle lcd, uint8_t data);
+static void _busClaim(LCD_Handle lcd);
+static void _busRelease(LCD_Handle lcd);
+static void _command(LCD_Handle lcd, uint8_t value);
+static void _send(LCD_Handle lcd, uint8_t value, uint8_t mode);
+static void _write4bits(LCD_Handle lcd, uint8_t value);
+static void _expanderWrite(LCD_Handle lcd, uint8_t _data);
+static void _pulseEnable(LCD_Handle lcd, uint8_t _data);
+static void _flush(LCD_Handle lcd);
+static void _wait(LCD_Handle lcd, uint32_t durationUs);
+static void _waitBusyFlag(LCD_Handle lcd, uint32_t timeoutUs);
+static uint8_t _readStatus(LCD_Handle lcd);
+static uint8_t _expanderRead(LCD_Handle lcd);
+static void _resyncAddress(LCD_Handle lcd);
+static void _transferDone(LCD_Handle lcd);
+static void _dmaInit(LCD_Bus * bus);
+static void _dmaStart(LCD_Handle lcd, uint8_t * buffer, uint16_t length);
+static void _dmaIntHandler(LCD_Bus * bus);
+static void _i2cIntHandler(LCD_Bus * bus);
+static void _queueInit(LCD_Bus * bus);
+static void _queuePush(LCD_Handle lcd, uint16_t entry);
+static void _queueDelay(LCD_Handle lcd, uint32_t durationUs);
+static void _queueKick(LCD_Handle lcd);
+static void _queueService(LCD_Bus * bus);
+static void _queueStart(LCD_Bus * bus, LCD_Handle lcd);
+static void _queueArmTimer(void);
+static void _queueIntHandler(LCD_Bus * bus, uint_fast16_t intStatus);
+static void _uploadChar(LCD_Handle lcd, uint8_t slot, const uint8_t * charMap);
+static uint8_t _glyphCode(LCD_Handle lcd, uint8_t glyphId);
+static bool _slotOnScreen(LCD_Handle lcd, uint8_t slot, const uint8_t * except);
+static void _writeCells(LCD_Handle lcd, const uint8_t * charBuffer, uint8_t numChars, bool escapes);
+static void _writeCell(LCD_Handle lcd, uint8_t value);
+static void _sendCell(LCD_Handle lcd, uint8_t address, uint8_t value);
+static void _writeNumber(LCD_Handle lcd, uint32_t magnitude, bool negative, uint8_t base,
+                         uint8_t decimals, uint8_t width, uint8_t pad, uint8_t letters);
+static void _seekAddress(LCD_Handle lcd, uint8_t address);
+static void _syncCursor(LCD_Handle lcd);
+static uint8_t _nextAddress(LCD_Handle lcd, uint8_t address);
+static uint8_t * _shadowCell(LCD_Handle lcd, uint8_t address);
+static void _clearDisplay(LCD_Handle lcd);
+static void _transferLost(LCD_Handle lcd);
+static uint32_t _instructionUs(LCD_Handle lcd);
+static uint32_t _longInstructionUs(LCD_Handle lcd);
+static uint8_t _unshiftSteps(LCD_Handle lcd);
+static void _unshift(LCD_Handle lcd);
+static uint8_t _dirtyCells(LCD_Handle lcd, uint8_t * runs);
+static void _blankDirtyCells(LCD_Handle lcd);
+static void _putCell(LCD_Handle lcd, uint8_t address, uint8_t value);
+static uint8_t _marqueeChar(LCD_Handle lcd, uint8_t row, uint32_t index);
+static void _fbRefresh(LCD_Handle lcd);
+static void _fieldRender(LCD_Handle lcd, LCD_Field * field);
+static bool _refreshAllowed(LCD_Handle lcd);
+static void _refreshAttach(LCD_Handle lcd);
+static void _refreshDetach(LCD_Handle lcd);
+#ifdef LCD_PROFILE
+static uint32_t _profileStart(void);
+static void _profileRecord(uint8_t id, uint32_t start);
+#endif
 
 /********************************
  * Global variables specific to file
  ********************************/
-static uint8_t _displayControl; // Handles display and cursor
-static uint8_t _displayMode;    // Handles the direction of text
-static uint8_t _backlightVal;   // Whether back light is on or off
+#define BUSY_FLAG           0x80    // Status bit 7, the rest is the address counter
+#define READ_DATA_PINS      0xF0    // PCF8574 pins high so the LCD can drive them
+
+/********************************
+ * Shadow copy of DDRAM
+ *
+ * address is where the next character will land as far
+ * as the caller is concerned. hwAddress is where the
+ * controller's address counter actually is. They only have
+ * to agree when a cell is written or the cursor is visible.
+ ********************************/
+#define SEEK_REWRITE_LIMIT  1   // Rewrite at most this many cells instead of jumping
+#define ROW_ADDRESS_MASK    0x40
+
+/********************************
+ * Command planner
+ *
+ * Clear and home keep the controller busy for 1.52ms (4.5ms
+ * when we can't read the busy flag). The shadow often shows
+ * a cheaper way to the same screen: home is undoing the
+ * display shift and moving the address, clear is blanking
+ * the few cells that aren't blank. Each way is costed in us
+ * of bus and execution time at the bus's rate, cheapest wins.
+ ********************************/
+#define INSTRUCTION_BYTES   6       // Two nibbles, each with an enable pulse
+#define LONG_FIXED_US       4500    // What _wait gives clear and home
+#define LONG_BUSY_US        1520    // What they take by the busy flag (page 24)
+
+/********************************
+ * Number formatting
+ *
+ * Digits go straight to _writeCell most significant first,
+ * one divide by a power of ten each, so there's no buffer
+ * to reverse and no C library. A number that doesn't fit
+ * its width shows as all FORMAT_OVERFLOW, fields never grow.
+ ********************************/
+#define FORMAT_OVERFLOW     '#'
+#define FORMAT_MAX_DECIMALS 9
+
+static const uint32_t _powersOf10[10] =
+{
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+/********************************
+ * Marquee
+ *
+ * A display shift moves the 40 column DDRAM lines past the
+ * 16 column window, so scrolling costs one instruction per
+ * step. Text up to 40 chars is loaded once and goes round.
+ * Longer text (plus a screen of blanks) is fed in one char
+ * per step, into the column that just went off screen.
+ * Absolute index j of the text always sits in column j % 40.
+ ********************************/
+#define MARQUEE_GAP         LCD_COLUMNS     // Blanks after text longer than a line
+
+/********************************
+ * Framebuffer and fields
+ *
+ * The application draws into fb at any time and LCD_commit
+ * copies it to fbFront with interrupts off, so a refresh
+ * only ever sees whole frames. Fields hold the newest value
+ * set, a render shows whichever value is there by then.
+ *
+ * Timer_A0 ticks at LCD_REFRESH_HZ. The framebuffer and each
+ * field have their own interval in ticks, when it is up and
+ * something changed the cells that differ from the shadow
+ * are sent. A display uses one or the other, not both.
+ *
+ * Public calls that fill txBuffer or move the address bump
+ * inCall for as long as they run, and the refresh leaves
+ * that display until the next tick. The refresh never runs
+ * in blocking mode (it would spin on the bus from inside
+ * the interrupt) or with autoscroll on (every cell it
+ * writes would shift the display).
+ ********************************/
+#define REFRESH_TIMER_BASE  TIMER_A0_BASE
+#define REFRESH_PRIORITY    0xE0    // Below the bus interrupts a refresh waits on
+
+#define CALL_ENTER(lcd)     ((lcd)->inCall++)
+#define CALL_EXIT(lcd)      ((lcd)->inCall--)
+
+static LCD_Handle _refreshDisplays;     // Displays the refresh timer serves
+
+/********************************
+ * Glyph cache
+ *
+ * The application registers a table of glyphs (any size,
+ * normally const so it stays in flash) and writes them by
+ * ID. The 8 CGRAM slots hold whichever were used last.
+ * cgramGlyph shadows what each slot holds so a glyph is
+ * only uploaded when it isn't already there. A slot still
+ * showing on screen is never evicted, it would change
+ * every cell that uses it.
+ ********************************/
+#define GLYPH_NONE          0xFF    // Slot holds nothing we know of
+#define GLYPH_PINNED        0xFE    // Slot was set by LCD_createChar
+#define CGRAM_MIRROR        0x08    // Codes 0x08-0x0F show slots 0-7 too
+
+/********************************
+ * DMA transfer state
+ *
+ * In LCD_TRANSFER_DMA mode a flushed buffer is handed to
+ * the bus's uDMA channel (EUSCI_Bx TX0 trigger) and the
+ * display's other buffer is filled while it goes out.
+ * The driver owns the channel control table, so the
+ * application can't use the DMA for anything else then.
+ ********************************/
+#pragma DATA_ALIGN(_dmaControlTable, 1024)
+static DMA_ControlTable _dmaControlTable[32];
+
+static bool _dmaModuleReady;            // Control table set up
+
+/********************************
+ * Command queue for LCD_TRANSFER_QUEUED mode
+ *
+ * Each display has its own queue. Each entry is an expander
+ * byte, or a settle time in us when QUEUE_DELAY is set.
+ * The bus interrupt streams one display's bytes until they
+ * reach a delay (or QUEUE_BURST_LIMIT), sends STOP, then
+ * moves on to the next display that isn't settling.
+ * TIMER32_1 wakes the bus when the earliest delay ends.
+ *
+ * Single producer (LCD_* calls), single consumer (ISRs)
+ ********************************/
+#define QUEUE_MASK          (LCD_QUEUE_SIZE - 1)
+#define QUEUE_DELAY         0x8000
+#define QUEUE_MAX_DELAY     0x7FFF
+#define QUEUE_BURST_LIMIT   48      // 8 characters, then let another display in
+#define QUEUE_TIMER_BASE    TIMER32_1_BASE
+
+static bool _queueTimerReady;           // Settle timer set up
+
+/********************************
+ * Timing model
+ *
+ * Every expander byte takes 9 SCL periods on the wire, so
+ * the bus itself is our delay. After an enable falling edge
+ * the next rising edge is 2 bytes away. settleBytes pads
+ * with idle bytes only if that is shorter than 37us.
+ *
+ * lastEdge is the TIMER32_0 tick of a display's last enable
+ * edge, long waits only sleep for what hasn't already passed.
+ ********************************/
+#define SETTLE_US           37      // Execution time of most instructions
+#define EDGE_BYTES          2       // Bytes between enable falling and rising edge
+#define BITS_PER_BYTE       9       // 8 data bits and ACK
+
+/********************************
+ * Clocks are read at init and on LCD_clockChanged()
+ * TIMER32 runs from MCLK, EUSCI_B from SMCLK
+ ********************************/
+static uint32_t _timerClock;        // MCLK in Hz
+static uint32_t _ticksPerUsQ16;     // TIMER32 ticks per microsecond, 16.16 rounded up
+
+/********************************
+ * Rate probing
+ *
+ * Fastest first. At each rate we write patterns to the
+ * expander with E low (the LCD ignores them) and read the
+ * pins back. Any NACK, timeout or mismatch drops a rate.
+ ********************************/
+#define MIN_I2C_PRESCALER   4       // eUSCI_B needs SMCLK at least 4x SCL
+#define PROBE_PASSES        8       // Round trips per rate
+#define PROBE_TIMEOUT       10000   // Polling loops before a byte is given up on
+
+static const uint32_t _probeRates[] = { LCD_I2C_FAST_PLUS, LCD_I2C_FAST, LCD_I2C_STANDARD };
+static const uint8_t _probePatterns[] = { 0xA0, 0x50, 0xF0, 0x00 };
+
+/********************************
+ * Profiling build (define LCD_PROFILE)
+ *
+ * Calls that touch the bus, and _expanderWrite, are timed
+ * with the DWT cycle counter from entry to exit. Nested
+ * calls are included in their caller's time. Cycle counts
+ * go in log2 buckets: bucket b holds counts below 2^b.
+ ********************************/
+#ifdef LCD_PROFILE
+#define PROFILE_ENTER()             uint32_t profileStart = _profileStart()
+#define PROFILE_EXIT(id)            _profileRecord(id, profileStart)
+#define PROFILE_RETURN(id, value)   do { int profileResult = (value); \
+                                         PROFILE_EXIT(id); \
+                                         return profileResult; } while(0)
+
+static LCD_Profile _profiles[LCD_PROFILE_COUNT];
+
+static const char * const _profileNames[LCD_PROFILE_COUNT] =
+{
+    "init", "clear", "home", "displayOn", "displayOff", "setCursorPosition",
+    "cursorOn", "cursorOff", "blinkOn", "blinkOff", "shiftDisplayLeft",
+    "shiftDisplayRight", "textLeftToRight", "textRightToLeft", "autoscrollOn",
+    "autoscrollOff", "backlightOn", "backlightOff", "createChar", "writeGlyph",
+    "writeChar", "writeString", "writeRaw", "writeInt", "writeFixed", "writeHex", "printf",
+    "marqueeStart", "marqueeStep", "setTimingMode", "setTransferMode", "waitIdle",
+    "clockChanged", "_expanderWrite"
+};
+#else
+#define PROFILE_ENTER()
+#define PROFILE_EXIT(id)
+#define PROFILE_RETURN(id, value)   return (value)
+#endif
+
+/********************************/
+static LCD_Bus * _busFor(uint32_t moduleInstance)
+{
+    int i;
+    for(i = 0; i < BUS_COUNT; i++)
+    {
+        if(_buses[i].base == moduleInstance)
+        {
+            return &_buses[i];
+        }
+    }
+
+    return 0;
+}
+
+/********************************
+ * Add a display to its bus, taking it off first
+ * in case LCD_init is called on it again
+ ********************************/
+static void _busAttach(LCD_Bus * bus, LCD_Handle lcd)
+{
+    int i;
+    for(i = 0; i < BUS_COUNT; i++)
+    {
+        LCD_Handle * link = &_buses[i].displays;
+        while(*link)
+        {
+            if(*link == lcd)
+            {
+                *link = lcd->next;
+                break;
+            }
+            link = &(*link)->next;
+        }
+
+        if(_buses[i].cursor == lcd)
+        {
+            _buses[i].cursor = 0;
+        }
+    }
+
+    // The refresh timer mustn't keep serving it, or lose the
+    // displays after it on its list to the memset
+    lcd->fbRunning = false;
+    lcd->fields = NULL;
+    _refreshDetach(lcd);
+
+    memset(lcd, 0, sizeof(LCD_Object));
+    lcd->bus = bus;
+    lcd->txBuffer = lcd->txBuffers[0];
+    lcd->next = bus->displays;
+    bus->displays = lcd;
+}
+
+/********************************/
+static void _busWaitIdle(LCD_Bus * bus)
+{
+    LCD_Handle lcd;
+    for(lcd = bus->displays; lcd; lcd = lcd->next)
+    {
+        LCD_waitIdle(lcd);
+    }
+}
+
+/********************************
+ * Read MCLK/SMCLK, microsecond delays need MCLK >= 1MHz
+ * Returns: 1 on success, 0 otherwise
+ ********************************/
+static int _clockInit(void)
+{
+    _timerClock = CS_getMCLK();
+    _ticksPerUsQ16 = (uint32_t)((((uint64_t)_timerClock << 16) + 999999) / 1000000);
+
+    int i;
+    for(i = 0; i < BUS_COUNT; i++)
+    {
+        _buses[i].config.i2cClk = CS_getSMCLK();
+    }
+
+    if(_timerClock < 1000000)
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+/********************************
+ * Call after changing MCLK or SMCLK (e.g. going to 48MHz)
+ * Rescales delays and reprograms the EUSCI_B dividers
+ * for the same bus speeds
+ *
+ * Returns: 1 on success, 0 if a speed can't be kept
+ ********************************/
+int LCD_clockChanged(void)
+{
+    PROFILE_ENTER();
+
+    int i;
+    for(i = 0; i < BUS_COUNT; i++)
+    {
+        _busWaitIdle(&_buses[i]);
+    }
+
+    if(!_clockInit())
+    {
+        PROFILE_RETURN(LCD_PROFILE_CLOCK_CHANGED, 0);
+    }
+
+    int success = 1;
+    for(i = 0; i < BUS_COUNT; i++)
+    {
+        LCD_Bus * bus = &_buses[i];
+        if(!bus->displays)
+        {
+            continue;
+        }
+
+        if(!_i2cSetRate(bus, bus->config.dataRate))
+        {
+            success = 0;
+        }
+
+        _timingInit(bus);
+    }
+
+    PROFILE_RETURN(LCD_PROFILE_CLOCK_CHANGED, success);
+}
+
+/********************************
+ * We want to use the TIMER32 on the MSP432
+ * because this will allow us to use the same
+ * code with different clock frequencies easily
+ *
+ * TIMER32_0 free runs so it doubles as a timestamp
+ * Changes made to the TIMER32 could affect the LCD
+ ********************************/
+static void _delayInit(void)
+{
+    Timer32_initModule(TIMER32_BASE, TIMER32_PRESCALER_1,
+                           TIMER32_32BIT, TIMER32_FREE_RUN_MODE);
+    Timer32_startTimer(TIMER32_BASE, false);
+}
+
+static void _delayMicroseconds(uint32_t durationUs)
+{
+    uint32_t start = _now();
+    uint32_t ticks = _usToTicks(durationUs);
+
+    while((_now() - start) < ticks);
+}
+
+/********************************
+ * Rounded up, a clock that isn't a whole number of
+ * MHz (1.5MHz DCO) mustn't cut delays short. No divide,
+ * the queue converts in its interrupt.
+ ********************************/
+static uint32_t _usToTicks(uint32_t durationUs)
+{
+    return (uint32_t)(((uint64_t)durationUs * _ticksPerUsQ16 + 0xFFFF) >> 16);
+}
+
+/********************************
+ * TIMER32_0 ticks to microseconds at the current MCLK,
+ * rounded down so waits worked out from it run long
+ ********************************/
+uint32_t LCD_ticksToUs(uint32_t ticks)
+{
+    return (uint32_t)(((uint64_t)ticks * 1000000) / _timerClock);
+}
+
+/********************************
+ * TIMER32_0 counts down, flip it so time goes up
+ ********************************/
+static uint32_t _now(void)
+{
+    return ~Timer32_getValue(TIMER32_BASE);
+}
+
+/********************************/
+static void _timingInit(LCD_Bus * bus)
+{
+    uint32_t rate = bus->config.dataRate;
+    bus->byteTicks = (BITS_PER_BYTE * _timerClock + rate - 1) / rate;
+
+    uint32_t bytes = (SETTLE_US * rate + (1000000 * BITS_PER_BYTE) - 1)
+                         / (1000000 * BITS_PER_BYTE);
+    bus->settleBytes = (bytes > EDGE_BYTES) ? bytes - EDGE_BYTES : 0;
+}
+
+/********************************
+ * Wait until durationUs has passed since the last enable edge
+ ********************************/
+static void _settle(LCD_Handle lcd, uint32_t durationUs)
+{
+    int32_t elapsedTicks = (int32_t)(_now() - lcd->lastEdge);
+    int32_t elapsedUs = (elapsedTicks > 0) ? (int32_t)LCD_ticksToUs(elapsedTicks) : 0;
+
+    if(elapsedUs < (int32_t)durationUs)
+    {
+        _delayMicroseconds(durationUs - elapsedUs);
+        lcd->stats.delayUs += durationUs - elapsedUs;
+    }
+}
+
+/********************************
+ * Hold the bus on the last state until the
+ * instruction has had 37us to execute
+ ********************************/
+static void _padSettle(LCD_Handle lcd, uint8_t data)
+{
+    uint8_t i;
+    for(i = 0; i < lcd->bus->settleBytes; i++)
+    {
+        _expanderWrite(lcd, data);
+    }
+}
+
+/********************************
+ * Initializes the I2C EUSCI_B module on the MSP432
+ * EUSCI_B0: Pin 1.6 = SDA (Data), Pin 1.7 = SCL (Clock)
+ * EUSCI_B1: Pin 6.4 = SDA (Data), Pin 6.5 = SCL (Clock)
+ *
+ * The first display on a bus sets its speed. Later ones
+ * can only slow it down, every display has to keep up.
+ *
+ * Returns: 1 on success, 0 otherwise
+ ********************************/
+static int _i2cInit(LCD_Handle lcd, uint32_t busSpeed)
+{
+    LCD_Bus * bus = lcd->bus;
+    bool shared = (lcd->next != 0);
+
+    if(!shared)
+    {
+        GPIO_setAsPeripheralModuleFunctionInputPin(bus->port,
+                bus->pins, GPIO_PRIMARY_MODULE_FUNCTION);
+    }
+
+    uint32_t maxSpeed = shared ? bus->config.dataRate : LCD_I2C_FAST_PLUS;
+
+    if(busSpeed == LCD_I2C_PROBE)
+    {
+        return _i2cProbeRate(lcd, maxSpeed);
+    }
+
+    if(busSpeed > maxSpeed)
+    {
+        busSpeed = maxSpeed;
+    }
+
+    if(shared && busSpeed == bus->config.dataRate)
+    {
+        return 1;
+    }
+
+    return _i2cSetRate(bus, busSpeed);
+}
+
+/********************************
+ * (Re)configure a EUSCI_B module for a new SCL rate
+ * Returns: 1 on success, 0 if SMCLK is too slow for it
+ ********************************/
+static int _i2cSetRate(LCD_Bus * bus, uint32_t busSpeed)
+{
+    if(busSpeed == 0 || bus->config.i2cClk / busSpeed < MIN_I2C_PRESCALER)
+    {
+        return 0;
+    }
+
+    I2C_disableModule(bus->base);
+
+    // Initialize based on config
+    bus->config.dataRate = busSpeed;
+    I2C_initMaster(bus->base, &bus->config);
+
+    // Set master in transmit mode
+    I2C_setMode(bus->base, EUSCI_B_I2C_TRANSMIT_MODE);
+
+    // Enable to start operation
+    I2C_enableModule(bus->base);
+
+    _timingInit(bus);
+
+    return 1;
+}
+
+/********************************
+ * Settle on the fastest rate up to maxSpeed that
+ * this display's expander handles reliably
+ * Returns: 1 on success, 0 if nothing worked
+ ********************************/
+static int _i2cProbeRate(LCD_Handle lcd, uint32_t maxSpeed)
+{
+    uint8_t i;
+    for(i = 0; i < sizeof(_probeRates) / sizeof(_probeRates[0]); i++)
+    {
+        if(_probeRates[i] > maxSpeed)
+        {
+            continue;
+        }
+
+        if(_probeRates[i] != lcd->bus->config.dataRate &&
+           !_i2cSetRate(lcd->bus, _probeRates[i]))
+        {
+            continue;
+        }
+
+        bool reliable = true;
+        int pass;
+        for(pass = 0; pass < PROBE_PASSES && reliable; pass++)
+        {
+            uint8_t pattern = _probePatterns[pass % sizeof(_probePatterns)];
+            reliable = _expanderCheck(lcd, pattern | lcd->backlightVal);
+        }
+
+        if(reliable)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/********************************
+ * Write one byte to the expander and read the pins back
+ * R/W is low so the LCD isn't driving the data lines
+ ********************************/
+static bool _expanderCheck(LCD_Handle lcd, uint8_t data)
+{
+    uint32_t base = lcd->bus->base;
+
+    _busClaim(lcd);
+    lcd->stats.transactions++;
+    lcd->stats.bytes++;
+
+    if(!I2C_masterSendSingleByteWithTimeout(base, data, PROBE_TIMEOUT) ||
+       I2C_getInterruptStatus(base, EUSCI_B_I2C_NAK_INTERRUPT))
+    {
+        EUSCI_B_CMSIS(base)->CTLW0 |= EUSCI_B_CTLW0_TXSTP;
+        I2C_clearInterruptFlag(base, EUSCI_B_I2C_NAK_INTERRUPT);
+        lcd->stats.nacks++;
+        _busRelease(lcd);
+        return false;
+    }
+
+    bool match = (I2C_masterReceiveSingleByte(base) == data);
+    lcd->stats.transactions++;
+    _busRelease(lcd);
+
+    return match;
+}
+
+/********************************
+ * Reads are polled, not DMA or queued, so they take the
+ * bus off the other displays on it first. A refresh or
+ * DMA transfer can't start for anyone until it's released.
+ ********************************/
+static void _busClaim(LCD_Handle lcd)
+{
+    LCD_Bus * bus = lcd->bus;
+    bool claimed = false;
+
+    while(!claimed)
+    {
+        bool intsDisabled = Interrupt_disableMaster();
+
+        if(!bus->busy)
+        {
+            bus->busy = true;
+            bus->active = lcd;
+            claimed = true;
+        }
+
+        if(!intsDisabled)
+        {
+            Interrupt_enableMaster();
+        }
+    }
+
+    I2C_setSlaveAddress(bus->base, lcd->slaveAddress);
+}
+
+/********************************
+ * Writes expect the module in transmit mode
+ ********************************/
+static void _busRelease(LCD_Handle lcd)
+{
+    I2C_setMode(lcd->bus->base, EUSCI_B_I2C_TRANSMIT_MODE);
+    lcd->bus->busy = false;
+}
+
+/********************************
+ * Returns the SCL rate in use, handy after LCD_I2C_PROBE
+ ********************************/
+uint32_t LCD_getBusSpeed(LCD_Handle lcd)
+{
+    return lcd->bus->config.dataRate;
+}
+
+/********************************
+ * Code created according to the data sheet (page 45/46)
+ * https://www.sparkfun.com/datasheets/LCD/HD44780.pdf
+ *
+ * Param: Display object to set up
+ * Param: EUSCI_B0_BASE or EUSCI_B1_BASE
+ * Param: Slave address of LCD
+ * Param: SCL rate (LCD_I2C_STANDARD, _FAST, _FAST_PLUS)
+ *        or LCD_I2C_PROBE to pick the fastest that works
+ * Returns: 1 on success, 0 otherwise
+ *
+ * Initialize every display on a bus before switching
+ * that bus to DMA or queued mode
+ ********************************/
+int LCD_init(LCD_Handle lcd, uint32_t moduleInstance, uint8_t slaveAddress, uint32_t busSpeed)
+{
+    PROFILE_ENTER();
+
+    LCD_Bus * bus = _busFor(moduleInstance);
+    if(!bus || bus->transferMode != LCD_TRANSFER_BLOCKING)
+    {
+        // Failed
+        PROFILE_RETURN(LCD_PROFILE_INIT, 0);
+    }
+
+    // Delays and I2C dividers come from the clocks we're running at
+    if(!_clockInit())
+    {
+        // Failed
+        PROFILE_RETURN(LCD_PROFILE_INIT, 0);
+    }
+
+    _busAttach(bus, lcd);
+    lcd->slaveAddress = slaveAddress;
+    memset(lcd->cgramGlyph, GLYPH_NONE, sizeof(lcd->cgramGlyph));
+
+    // Default display, text direction, and back light
+    uint8_t displayFunction = LCD_4BITMODE | LCD_2LINE | LCD_5x8DOTS;
+    lcd->displayMode = LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT;
+    lcd->backlightVal = LCD_BACKLIGHT;
+
+    if(!_i2cInit(lcd, busSpeed))
+    {
+        // Failed
+        PROFILE_RETURN(LCD_PROFILE_INIT, 0);
+    }
+
+    _delayInit();
+    lcd->lastEdge = _now();
+
+    // Busy flag can't be read until we're in 4 bit mode
+    lcd->timingMode = LCD_TIMING_FIXED;
+
+    // We need at least 40ms after power rises above 2.7V
+    _wait(lcd, 50 * 1000);
+
+    // Now we pull both RS and R/W low to begin commands
+    _expanderWrite(lcd, lcd->backlightVal);
+
+    // We start in 8 bit mode, try to set 4 bit mode
+    _write4bits(lcd, 0x03 << 4);
+    _wait(lcd, 45 * 100); // Wait more than 4.1ms
+
+    // Second try
+    _write4bits(lcd, 0x03 << 4);
+    _wait(lcd, 150); // Wait more than 100us
+
+    // Third try
+    _write4bits(lcd, 0x03 << 4);
+    _padSettle(lcd, 0x03 << 4);
+
+    // Finally, set to 4-bit interface
+    _write4bits(lcd, 0x02 << 4);
+    _padSettle(lcd, 0x02 << 4);
+
+    // Set number of lines, font size...
+    _command(lcd, LCD_FUNCTIONSET | displayFunction);
+
+    // Turn the display on with blinking cursor for default
+    lcd->displayControl = LCD_DISPLAYON | LCD_CURSORON | LCD_BLINKON;
+    LCD_displayOn(lcd);
+
+    // Clear it off, DDRAM holds whatever was there before reset
+    _clearDisplay(lcd);
+
+    // Set the entry mode
+    _command(lcd, LCD_ENTRYMODESET | lcd->displayMode);
+
+    // Set cursor to start position
+    LCD_home(lcd);
+
+    PROFILE_RETURN(LCD_PROFILE_INIT, 1);
+}
+
+/********************************
+ * Clear display and set cursor position to zero
+ * Blanks just the cells that need it when that is quicker
+ * than the clear command, the screen ends up the same
+ ********************************/
+void LCD_clear(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    memset(lcd->marqueeText, 0, sizeof(lcd->marqueeText));
+
+    uint8_t runs;
+    uint8_t cells = _dirtyCells(lcd, &runs);
+    uint32_t instructionUs = _instructionUs(lcd);
+    uint32_t plannedUs = (cells + runs + _unshiftSteps(lcd) + 1) * instructionUs;
+
+    // Writes move the display in autoscroll mode, only clear works,
+    // and only clear is sure to blank a shadow we can't trust
+    if(lcd->ddramValid && !(lcd->displayMode & LCD_ENTRYSHIFTINCREMENT) &&
+       plannedUs < instructionUs + _longInstructionUs(lcd))
+    {
+        _unshift(lcd);
+        _blankDirtyCells(lcd);
+        lcd->address = 0;
+        _syncCursor(lcd);
+        _flush(lcd);
+    }
+    else
+    {
+        _clearDisplay(lcd);
+    }
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_CLEAR);
+}
+
+/********************************
+ * The clear command itself
+ * This command takes a long time (delay needed)
+ ********************************/
+static void _clearDisplay(LCD_Handle lcd)
+{
+    // Clearing fills DDRAM with spaces, zeroes the address counter
+    // and undoes any display shift. Set first, a NACK on the
+    // command itself has to be able to take it back.
+    memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+    lcd->ddramValid = true;
+    lcd->address = 0;
+    lcd->hwAddress = 0;
+    lcd->hwAddressValid = true;
+    lcd->displayShift = 0;
+
+    _command(lcd, LCD_CLEARDISPLAY);
+    _wait(lcd, 45 * 100);
+
+    // It also forces left to right, put the direction back (page 24)
+    if(!(lcd->displayMode & LCD_ENTRYLEFT))
+    {
+        _command(lcd, LCD_ENTRYMODESET | lcd->displayMode);
+    }
+}
+
+/********************************
+ * Set cursor position to zero and undo any display shift
+ * Return home takes a long time, shifting back and moving
+ * the address is usually quicker
+ ********************************/
+void LCD_home(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    memset(lcd->marqueeText, 0, sizeof(lcd->marqueeText));
+
+    uint32_t instructionUs = _instructionUs(lcd);
+    uint32_t plannedUs = (_unshiftSteps(lcd) + 1) * instructionUs;
+
+    if(plannedUs < instructionUs + _longInstructionUs(lcd))
+    {
+        _unshift(lcd);
+        lcd->address = 0;
+        _syncCursor(lcd);
+        _flush(lcd);
+    }
+    else
+    {
+        lcd->address = 0;
+        lcd->hwAddress = 0;
+        lcd->hwAddressValid = true;
+        lcd->displayShift = 0;
+
+        _command(lcd, LCD_RETURNHOME);
+        _wait(lcd, 45 * 100);
+    }
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_HOME);
+}
+
+/********************************
+ * Turn the display on or off
+ * This isn't the same as turning on/off the backlight
+ ********************************/
+void LCD_displayOn(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    lcd->displayControl |= LCD_DISPLAYON;
+    _command(lcd, LCD_DISPLAYCONTROL | lcd->displayControl);
+    _syncCursor(lcd);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_DISPLAY_ON);
+}
+
+void LCD_displayOff(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    lcd->displayControl &= ~LCD_DISPLAYON;
+    _command(lcd, LCD_DISPLAYCONTROL | lcd->displayControl);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_DISPLAY_OFF);
+}
+
+/********************************
+ * Set the location of the cursor assuming 16x2 LCD
+ * Numbering is based on zero indexed arrays
+ * For example, rows are 0 or 1 (top or bottom)
+ * Columns go up to the end of the DDRAM line,
+ * LCD_LINE_LENGTH - 1, past 15 they're off screen
+ * until the display is shifted
+ ********************************/
+int LCD_setCursorPosition(LCD_Handle lcd, uint8_t row, uint8_t col)
+{
+   PROFILE_ENTER();
+   CALL_ENTER(lcd);
+
+   // Sanity check row and columns...
+   // No need to check less than 0 on unsigned byte
+   if(row >= LCD_ROWS || col >= LCD_LINE_LENGTH)
+   {
+       CALL_EXIT(lcd);
+       PROFILE_RETURN(LCD_PROFILE_SET_CURSOR_POSITION, 0);
+   }
+
+   int row_offsets[] = { 0x00, 0x40 };
+   lcd->address = col + row_offsets[row];
+
+   // Only move the controller now if someone can see the cursor
+   _syncCursor(lcd);
+
+   CALL_EXIT(lcd);
+   PROFILE_RETURN(LCD_PROFILE_SET_CURSOR_POSITION, 1);
+}
+
+/********************************
+ * Display or hide the cursor
+ ********************************/
+void LCD_cursorOn(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    lcd->displayControl |= LCD_CURSORON;
+    _command(lcd, LCD_DISPLAYCONTROL | lcd->displayControl);
+    _syncCursor(lcd);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_CURSOR_ON);
+}
+
+void LCD_cursorOff(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    lcd->displayControl &= ~LCD_CURSORON;
+    _command(lcd, LCD_DISPLAYCONTROL | lcd->displayControl);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_CURSOR_OFF);
+}
+
+/********************************
+ * Turn blinking cursor on/off
+ ********************************/
+void LCD_blinkOn(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    lcd->displayControl |= LCD_BLINKON;
+    _command(lcd, LCD_DISPLAYCONTROL | lcd->displayControl);
+    _syncCursor(lcd);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_BLINK_ON);
+}
+
+void LCD_blinkOff(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    lcd->displayControl &= ~LCD_BLINKON;
+    _command(lcd, LCD_DISPLAYCONTROL | lcd->displayControl);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_BLINK_OFF);
+}
+
+/********************************
+ * Shifts the text on display 1 position to right or left
+ * These functions will wrap text (they'll come out other side)
+ ********************************/
+void LCD_shiftDisplayLeft(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    _command(lcd, LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVELEFT);
+    lcd->displayShift = (lcd->displayShift + 1) % LCD_LINE_LENGTH;
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_SHIFT_DISPLAY_LEFT);
+}
+
+void LCD_shiftDisplayRight(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    _command(lcd, LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVERIGHT);
+    lcd->displayShift = (lcd->displayShift + LCD_LINE_LENGTH - 1) % LCD_LINE_LENGTH;
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_SHIFT_DISPLAY_RIGHT);
+}
+
+/********************************
+ * Set the direction or writing text to
+ * left -> right or right -> left
+ *
+ * Default is left to right
+ ********************************/
+void LCD_textLeftToRight(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    lcd->displayMode |= LCD_ENTRYLEFT;
+    _command(lcd, LCD_ENTRYMODESET | lcd->displayMode);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_TEXT_LEFT_TO_RIGHT);
+}
+
+void LCD_textRightToLeft(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    lcd->displayMode &= ~LCD_ENTRYLEFT;
+    _command(lcd, LCD_ENTRYMODESET | lcd->displayMode);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_TEXT_RIGHT_TO_LEFT);
+}
+
+/********************************
+ * This will right justify text if on
+ * Or left justify if off
+ ********************************/
+void LCD_autoscrollOn(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    lcd->displayMode |= LCD_ENTRYSHIFTINCREMENT;
+    _command(lcd, LCD_ENTRYMODESET | lcd->displayMode);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_AUTOSCROLL_ON);
+}
+
+void LCD_autoscrollOff(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    lcd->displayMode &= ~LCD_ENTRYSHIFTINCREMENT;
+    _command(lcd, LCD_ENTRYMODESET | lcd->displayMode);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_AUTOSCROLL_OFF);
+}
+
+/********************************
+ * Turn the back light on or off
+ * Default is on
+ ********************************/
+void LCD_backlightOn(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    lcd->backlightVal = LCD_BACKLIGHT;
+    _expanderWrite(lcd, 0);
+    _flush(lcd);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_BACKLIGHT_ON);
+}
+
+void LCD_backlightOff(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    lcd->backlightVal = LCD_NOBACKLIGHT;
+    _expanderWrite(lcd, 0);
+    _flush(lcd);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_BACKLIGHT_OFF);
+}
+
+/********************************
+ * Returns 1 if back light is on, 0 if off
+ ********************************/
+int LCD_isBacklightOn(LCD_Handle lcd)
+{
+    if(lcd->backlightVal == LCD_BACKLIGHT)
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+/********************************
+ * We can create and store up to 8 custom characters to CGRAM
+ * Look at data sheet starting at page 13
+ *
+ * memAddress: Location in EEPROM (0 - 7)
+ * charMap: Array of uint8 that represent custom character
+ * Only the 5 least significant bits are looked at
+ *
+ * Example using a heart :
+ * uint8_t heart[CHAR_HEIGHT] = { 0x00, 0x0A, 0x1F, 0x1F, 0x0E, 0x04, 0x00 };
+ * [ 0 0 0 0 0      -> 0x00 = 0b00000
+ *   0 1 0 1 0      -> 0x0A = 0b01010
+ *   1 1 1 1 1      -> 0x1F = 0b11111
+ *   1 1 1 1 1      -> 0x1F = 0b11111
+ *   0 1 1 1 0      -> 0x0E = 0b01110
+ *   0 0 1 0 0      -> 0x04 = 0b00100
+ *   0 0 0 0 0 ]    -> 0x00 = 0b00000
+ *   0 0 0 0 0 (Cursor)
+ *
+ *   Last row of bits (8th row) is dedicated to cursor
+ *   Custom char generator: https://omerk.github.io/lcdchargen/
+ *
+ ********************************/
+int LCD_createChar(LCD_Handle lcd, uint8_t memAddress, uint8_t charMap[])
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    // Sanity check that address is between 0 - 7
+    if(memAddress > 7)
+    {
+        // Failed
+        CALL_EXIT(lcd);
+        PROFILE_RETURN(LCD_PROFILE_CREATE_CHAR, 0);
+    }
+
+    _uploadChar(lcd, memAddress, charMap);
+
+    // The glyph cache leaves this slot alone from now on
+    lcd->cgramGlyph[memAddress] = GLYPH_PINNED;
+
+    _syncCursor(lcd);
+    _flush(lcd);
+
+    CALL_EXIT(lcd);
+    PROFILE_RETURN(LCD_PROFILE_CREATE_CHAR, 1);
+}
+
+/********************************
+ * Register the glyphs LCD_writeGlyph and LCD_GLYPH_ESCAPE
+ * refer to, glyph IDs are indexes into the table
+ *
+ * Example:
+ * static const uint8_t glyphs[][CHAR_HEIGHT] = { { ... heart ... }, { ... duck ... } };
+ * LCD_setGlyphTable(lcd, glyphs, 2);
+ *
+ * Returns: 1 on success, 0 if there are too many glyphs
+ ********************************/
+int LCD_setGlyphTable(LCD_Handle lcd, const uint8_t (*glyphs)[CHAR_HEIGHT], uint8_t count)
+{
+    if(count > LCD_MAX_GLYPHS)
+    {
+        // Failed
+        return 0;
+    }
+
+    lcd->glyphs = glyphs;
+    lcd->glyphCount = count;
+
+    // IDs mean something else now, forget what the slots hold
+    uint8_t slot;
+    for(slot = 0; slot < LCD_CGRAM_SLOTS; slot++)
+    {
+        if(lcd->cgramGlyph[slot] != GLYPH_PINNED)
+        {
+            lcd->cgramGlyph[slot] = GLYPH_NONE;
+        }
+    }
+
+    return 1;
+}
+
+/********************************
+ * Writes a glyph from the table at the cursor
+ * Returns: 1 on success, 0 if glyphId isn't registered
+ ********************************/
+int LCD_writeGlyph(LCD_Handle lcd, uint8_t glyphId)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    uint8_t sequence[2] = { LCD_GLYPH_ESCAPE, glyphId };
+    _writeCells(lcd, sequence, 2, true);
+
+    if(glyphId >= lcd->glyphCount)
+    {
+        CALL_EXIT(lcd);
+        PROFILE_RETURN(LCD_PROFILE_WRITE_GLYPH, 0);
+    }
+
+    CALL_EXIT(lcd);
+    PROFILE_RETURN(LCD_PROFILE_WRITE_GLYPH, 1);
+}
+
+/********************************
+ * Write a character bitmap to a CGRAM slot (page 19)
+ ********************************/
+static void _uploadChar(LCD_Handle lcd, uint8_t slot, const uint8_t * charMap)
+{
+    // Send mask of CGRAM address and location shifted 3 bits
+    _send(lcd, LCD_SETCGRAMADDR | (slot << 3), 0);
+
+    // Write each line of bits
+    int i;
+    for(i = 0; i < CHAR_HEIGHT; i++)
+    {
+        _send(lcd, charMap[i], REG_SELECT_BIT);
+    }
+
+    // Address counter now points into CGRAM
+    lcd->hwAddressValid = false;
+}
+
+/********************************
+ * Returns the character code that shows glyphId. If it
+ * isn't in CGRAM it replaces the least recently used slot
+ * that isn't pinned or on screen.
+ ********************************/
+static uint8_t _glyphCode(LCD_Handle lcd, uint8_t glyphId)
+{
+    if(glyphId >= lcd->glyphCount)
+    {
+        return LCD_GLYPH_MISSING;
+    }
+
+    lcd->glyphClock++;
+
+    uint8_t slot;
+    for(slot = 0; slot < LCD_CGRAM_SLOTS; slot++)
+    {
+        if(lcd->cgramGlyph[slot] == glyphId)
+        {
+            lcd->cgramUsed[slot] = lcd->glyphClock;
+            return slot;
+        }
+    }
+
+    // The cell this code is for is about to be overwritten
+    const uint8_t * target = _shadowCell(lcd, lcd->address);
+
+    uint8_t victim = LCD_CGRAM_SLOTS;
+    uint32_t oldest = 0;
+    for(slot = 0; slot < LCD_CGRAM_SLOTS; slot++)
+    {
+        if(lcd->cgramGlyph[slot] == GLYPH_PINNED)
+        {
+            continue;
+        }
+
+        uint32_t age = (lcd->cgramGlyph[slot] == GLYPH_NONE) ?
+                           UINT32_MAX : lcd->glyphClock - lcd->cgramUsed[slot];
+
+        if((victim == LCD_CGRAM_SLOTS || age > oldest) && !_slotOnScreen(lcd, slot, target))
+        {
+            victim = slot;
+            oldest = age;
+        }
+    }
+
+    // More custom characters on screen than the LCD can hold
+    if(victim == LCD_CGRAM_SLOTS)
+    {
+        return LCD_GLYPH_MISSING;
+    }
+
+    _uploadChar(lcd, victim, lcd->glyphs[glyphId]);
+    lcd->cgramGlyph[victim] = glyphId;
+    lcd->cgramUsed[victim] = lcd->glyphClock;
+
+    return victim;
+}
+
+/********************************
+ * True if any DDRAM cell but except shows this CGRAM slot
+ ********************************/
+static bool _slotOnScreen(LCD_Handle lcd, uint8_t slot, const uint8_t * except)
+{
+    uint8_t * cell = &lcd->ddram[0][0];
+    uint8_t * end = cell + sizeof(lcd->ddram);
+
+    for(; cell < end; cell++)
+    {
+        if(cell != except && (*cell & ~CGRAM_MIRROR) == slot)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/********************************
+ * Writes a single character to the LCD
+ * Wraps the cursor if position isn't on screen
+ ********************************/
+void LCD_writeChar(LCD_Handle lcd, uint8_t value)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    _writeCells(lcd, &value, 1, false);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_WRITE_CHAR);
+}
+
+/********************************
+ * Writes a string to the LCD
+ * Cells that already show the right character are skipped
+ *
+ * LCD_GLYPH_ESCAPE followed by a glyph ID writes that
+ * glyph, e.g. "Hi \x1B\x02" (see LCD_setGlyphTable)
+ ********************************/
+void LCD_writeString(LCD_Handle lcd, uint8_t * charBuffer, uint8_t numChars)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    _writeCells(lcd, charBuffer, numChars, true);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_WRITE_STRING);
+}
+
+/********************************
+ * Writes character codes as they are, LCD_GLYPH_ESCAPE
+ * included, for text that comes from outside (e.g. the
+ * USB protocol) and may hold any byte
+ * Cells that already show the right character are skipped
+ ********************************/
+void LCD_writeRaw(LCD_Handle lcd, const uint8_t * charBuffer, uint8_t numChars)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    _writeCells(lcd, charBuffer, numChars, false);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_WRITE_RAW);
+}
+
+/********************************
+ * Compares text against the DDRAM shadow and only
+ * sends the cells that changed. Autoscroll shifts the
+ * display on every write so nothing can be skipped then.
+ * With escapes LCD_GLYPH_ESCAPE and an ID become a glyph.
+ ********************************/
+static void _writeCells(LCD_Handle lcd, const uint8_t * charBuffer, uint8_t numChars, bool escapes)
+{
+    int i;
+    for(i = 0; i < numChars; i++)
+    {
+        uint8_t value = charBuffer[i];
+
+        // Escape and ID become the code of the slot holding the glyph
+        if(escapes && value == LCD_GLYPH_ESCAPE && i + 1 < numChars)
+        {
+            value = _glyphCode(lcd, charBuffer[++i]);
+        }
+
+        _writeCell(lcd, value);
+    }
+
+    _syncCursor(lcd);
+    _flush(lcd);
+}
+
+/********************************
+ * One character at the caller's cursor, skipped when the
+ * shadow already has it. Nothing goes out until _flush.
+ ********************************/
+static void _writeCell(LCD_Handle lcd, uint8_t value)
+{
+    bool canSkip = lcd->ddramValid && !(lcd->displayMode & LCD_ENTRYSHIFTINCREMENT);
+
+    if(!canSkip || *_shadowCell(lcd, lcd->address) != value)
+    {
+        _sendCell(lcd, lcd->address, value);
+    }
+
+    lcd->address = _nextAddress(lcd, lcd->address);
+}
+
+/********************************
+ * Send one character to address and keep the shadow,
+ * the address counter and the display shift in step
+ ********************************/
+static void _sendCell(LCD_Handle lcd, uint8_t address, uint8_t value)
+{
+    _seekAddress(lcd, address);
+    _send(lcd, value, REG_SELECT_BIT);
+    *_shadowCell(lcd, address) = value;
+    lcd->hwAddress = _nextAddress(lcd, lcd->hwAddress);
+
+    // Autoscroll moves the display with every write (page 26)
+    if(lcd->displayMode & LCD_ENTRYSHIFTINCREMENT)
+    {
+        lcd->displayShift = (lcd->displayMode & LCD_ENTRYLEFT) ?
+            (lcd->displayShift + 1) % LCD_LINE_LENGTH :
+            (lcd->displayShift + LCD_LINE_LENGTH - 1) % LCD_LINE_LENGTH;
+    }
+}
+
+/********************************
+ * Write a signed decimal at the cursor
+ * Param: width, 0 for as many cells as it takes,
+ *        otherwise right aligned in width cells
+ ********************************/
+void LCD_writeInt(LCD_Handle lcd, int32_t value, uint8_t width)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    uint32_t magnitude = (value < 0) ? -(uint32_t)value : (uint32_t)value;
+    _writeNumber(lcd, magnitude, value < 0, 10, 0, width, ' ', 0);
+
+    _syncCursor(lcd);
+    _flush(lcd);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_WRITE_INT);
+}
+
+/********************************
+ * Write a fixed point value at the cursor
+ * value is in units of 10^-decimals, e.g. 2345 with
+ * 2 decimals is "23.45" and -5 is "-0.05"
+ * Param: width as for LCD_writeInt
+ ********************************/
+void LCD_writeFixed(LCD_Handle lcd, int32_t value, uint8_t decimals, uint8_t width)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    if(decimals > FORMAT_MAX_DECIMALS)
+    {
+        decimals = FORMAT_MAX_DECIMALS;
+    }
+
+    uint32_t magnitude = (value < 0) ? -(uint32_t)value : (uint32_t)value;
+    _writeNumber(lcd, magnitude, value < 0, 10, decimals, width, ' ', 0);
+
+    _syncCursor(lcd);
+    _flush(lcd);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_WRITE_FIXED);
+}
+
+/********************************
+ * Write upper case hex at the cursor
+ * Param: width, 0 for as many digits as it takes,
+ *        otherwise zero padded to width
+ ********************************/
+void LCD_writeHex(LCD_Handle lcd, uint32_t value, uint8_t width)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    _writeNumber(lcd, value, false, 16, 0, width, '0', 'A');
+
+    _syncCursor(lcd);
+    _flush(lcd);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_WRITE_HEX);
+}
+
+/********************************
+ * Small printf straight to the display
+ * %[0][width][.decimals]d or i: signed, .decimals as LCD_writeFixed
+ * %[0][width]u, x, X: unsigned decimal or hex
+ * %[width]s, %c, %%
+ *
+ * Numbers that don't fit width show as all '#'. Text and
+ * strings are written as they are, no glyph escapes.
+ * Returns: 1 on success, 0 at an unsupported conversion
+ ********************************/
+int LCD_printf(LCD_Handle lcd, const char * format, ...)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    int result = 1;
+    va_list args;
+    va_start(args, format);
+
+    while(*format)
+    {
+        if(*format != '%')
+        {
+            _writeCell(lcd, (uint8_t)*format++);
+            continue;
+        }
+        format++;
+
+        uint8_t pad = ' ';
+        if(*format == '0')
+        {
+            pad = '0';
+            format++;
+        }
+
+        uint8_t width = 0;
+        while(*format >= '0' && *format <= '9')
+        {
+            width = width * 10 + (*format++ - '0');
+        }
+
+        uint8_t decimals = 0;
+        if(*format == '.')
+        {
+            format++;
+            while(*format >= '0' && *format <= '9')
+            {
+                decimals = decimals * 10 + (*format++ - '0');
+            }
+            if(decimals > FORMAT_MAX_DECIMALS)
+            {
+                decimals = FORMAT_MAX_DECIMALS;
+            }
+        }
+
+        char conversion = *format++;
+        if(conversion == 'd' || conversion == 'i')
+        {
+            int32_t value = va_arg(args, int);
+            uint32_t magnitude = (value < 0) ? -(uint32_t)value : (uint32_t)value;
+            _writeNumber(lcd, magnitude, value < 0, 10, decimals, width, pad, 0);
+        }
+        else if(conversion == 'u')
+        {
+            _writeNumber(lcd, va_arg(args, unsigned int), false, 10, 0, width, pad, 0);
+        }
+        else if(conversion == 'x' || conversion == 'X')
+        {
+            uint8_t letters = (conversion == 'x') ? 'a' : 'A';
+            _writeNumber(lcd, va_arg(args, unsigned int), false, 16, 0, width, pad, letters);
+        }
+        else if(conversion == 's')
+        {
+            const char * string = va_arg(args, const char *);
+            size_t length = strlen(string);
+            while(width > length)
+            {
+                _writeCell(lcd, ' ');
+                width--;
+            }
+            while(*string)
+            {
+                _writeCell(lcd, (uint8_t)*string++);
+            }
+        }
+        else if(conversion == 'c')
+        {
+            _writeCell(lcd, (uint8_t)va_arg(args, int));
+        }
+        else if(conversion == '%')
+        {
+            _writeCell(lcd, '%');
+        }
+        else
+        {
+            result = 0;
+            break;
+        }
+    }
+
+    va_end(args);
+
+    _syncCursor(lcd);
+    _flush(lcd);
+
+    CALL_EXIT(lcd);
+    PROFILE_RETURN(LCD_PROFILE_PRINTF, result);
+}
+
+/********************************
+ * Shared by the formatters, see number formatting at the top
+ * Param: pad, ' ' goes before the sign, '0' after it
+ *        letters, 'A' or 'a' for hex digits above 9
+ ********************************/
+static void _writeNumber(LCD_Handle lcd, uint32_t magnitude, bool negative, uint8_t base,
+                         uint8_t decimals, uint8_t width, uint8_t pad, uint8_t letters)
+{
+    // Digits it takes, at least one before the point
+    uint8_t digits = 1;
+    if(base == 16)
+    {
+        while(digits < 8 && (magnitude >> (4 * digits)))
+        {
+            digits++;
+        }
+    }
+    else
+    {
+        while(digits < 10 && magnitude >= _powersOf10[digits])
+        {
+            digits++;
+        }
+        if(digits <= decimals)
+        {
+            digits = decimals + 1;
+        }
+    }
+
+    uint8_t length = digits + (negative ? 1 : 0) + (decimals ? 1 : 0);
+    if(width && length > width)
+    {
+        while(width--)
+        {
+            _writeCell(lcd, FORMAT_OVERFLOW);
+        }
+        return;
+    }
+
+    uint8_t padding = width ? width - length : 0;
+    if(pad != '0')
+    {
+        for(; padding; padding--)
+        {
+            _writeCell(lcd, ' ');
+        }
+    }
+    if(negative)
+    {
+        _writeCell(lcd, '-');
+    }
+    for(; padding; padding--)
+    {
+        _writeCell(lcd, '0');
+    }
+
+    while(digits--)
+    {
+        uint8_t digit;
+        if(base == 16)
+        {
+            digit = (magnitude >> (4 * digits)) & 0x0F;
+        }
+        else
+        {
+            digit = magnitude / _powersOf10[digits];
+            magnitude -= digit * _powersOf10[digits];
+        }
+
+        _writeCell(lcd, (digit < 10) ? '0' + digit : letters + digit - 10);
+
+        if(decimals && digits == decimals)
+        {
+            _writeCell(lcd, '.');
+        }
+    }
+}
+
+/********************************
+ * Scroll text through a row, see the marquee notes at the top
+ * Call LCD_marqueeStep from a timer tick to move it along.
+ *
+ * The display shift moves both rows, a row without marquee
+ * text goes round with it. Characters are raw codes, glyph
+ * escapes aren't expanded. The text is used in place and
+ * must stay around until LCD_marqueeStop, LCD_clear or LCD_home.
+ *
+ * Returns: 1 on success, 0 if row is out of range, the
+ *          text is empty or autoscroll is on
+ ********************************/
+int LCD_marqueeStart(LCD_Handle lcd, uint8_t row, const uint8_t * text, uint16_t length)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    if(row >= LCD_ROWS || length == 0 || (lcd->displayMode & LCD_ENTRYSHIFTINCREMENT))
+    {
+        CALL_EXIT(lcd);
+        PROFILE_RETURN(LCD_PROFILE_MARQUEE_START, 0);
+    }
+
+    // The first marquee picks up wherever the display is shifted to
+    if(!lcd->marqueeText[0] && !lcd->marqueeText[1])
+    {
+        lcd->marqueeStep = lcd->displayShift;
+    }
+
+    lcd->marqueeText[row] = text;
+    lcd->marqueeLength[row] = length;
+    lcd->marqueeOrigin[row] = lcd->marqueeStep;
+
+    uint8_t rowAddress = row ? ROW_ADDRESS_MASK : 0;
+    uint8_t i;
+    for(i = 0; i < LCD_LINE_LENGTH; i++)
+    {
+        uint8_t col = (lcd->marqueeStep + i) % LCD_LINE_LENGTH;
+        _putCell(lcd, rowAddress | col, _marqueeChar(lcd, row, i));
+    }
+
+    _syncCursor(lcd);
+    _flush(lcd);
+
+    CALL_EXIT(lcd);
+    PROFILE_RETURN(LCD_PROFILE_MARQUEE_START, 1);
+}
+
+/********************************
+ * Stop feeding a row, it stays where it is
+ ********************************/
+void LCD_marqueeStop(LCD_Handle lcd, uint8_t row)
+{
+    if(row < LCD_ROWS)
+    {
+        lcd->marqueeText[row] = NULL;
+    }
+}
+
+/********************************
+ * Move every marquee one column left with a single
+ * shift, then refill the column that went off screen
+ * (nothing to send unless text is longer than a line)
+ ********************************/
+void LCD_marqueeStep(LCD_Handle lcd)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    if(!lcd->marqueeText[0] && !lcd->marqueeText[1])
+    {
+        CALL_EXIT(lcd);
+        PROFILE_EXIT(LCD_PROFILE_MARQUEE_STEP);
+        return;
+    }
+
+    _send(lcd, LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVELEFT, 0);
+    lcd->displayShift = (lcd->displayShift + 1) % LCD_LINE_LENGTH;
+
+    // Index marqueeStep just left the window, its column next shows + 40
+    uint8_t col = lcd->marqueeStep % LCD_LINE_LENGTH;
+    uint8_t row;
+    for(row = 0; row < LCD_ROWS; row++)
+    {
+        if(lcd->marqueeText[row])
+        {
+            uint32_t index = lcd->marqueeStep + LCD_LINE_LENGTH - lcd->marqueeOrigin[row];
+            _putCell(lcd, (row ? ROW_ADDRESS_MASK : 0) | col, _marqueeChar(lcd, row, index));
+        }
+    }
+    lcd->marqueeStep++;
+
+    _syncCursor(lcd);
+    _flush(lcd);
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_MARQUEE_STEP);
+}
+
+/********************************
+ * Character at index of a row's marquee, text then
+ * blanks, repeating
+ ********************************/
+static uint8_t _marqueeChar(LCD_Handle lcd, uint8_t row, uint32_t index)
+{
+    uint16_t length = lcd->marqueeLength[row];
+    uint32_t period = (length <= LCD_LINE_LENGTH) ? LCD_LINE_LENGTH : length + MARQUEE_GAP;
+
+    index %= period;
+    return (index < length) ? lcd->marqueeText[row][index] : ' ';
+}
+
+/********************************
+ * Hand the display over to the framebuffer
+ * From here on draw into LCD_framebuffer(lcd) and call
+ * LCD_commit. Other LCD calls on the display are safe,
+ * the refresh waits for them, but cells they write are
+ * overwritten by the next frame that differs there.
+ *
+ * Param: refreshHz, at most LCD_REFRESH_HZ
+ * Returns: 1 on success, 0 if the rate is out of range,
+ *          the display has fields, the bus is in blocking
+ *          mode or autoscroll is on
+ ********************************/
+int LCD_fbStart(LCD_Handle lcd, uint16_t refreshHz)
+{
+    if(refreshHz == 0 || refreshHz > LCD_REFRESH_HZ || lcd->fields || !_refreshAllowed(lcd))
+    {
+        return 0;
+    }
+
+    CALL_ENTER(lcd);
+
+    // Frames are drawn at the unshifted columns
+    LCD_home(lcd);
+
+    uint8_t row;
+    for(row = 0; row < LCD_ROWS; row++)
+    {
+        memcpy(lcd->fb[row], lcd->ddram[row], LCD_COLUMNS);
+        memcpy(lcd->fbFront[row], lcd->ddram[row], LCD_COLUMNS);
+    }
+    lcd->fbDirty = false;
+    lcd->fbInterval = LCD_REFRESH_HZ / refreshHz;
+    lcd->fbCountdown = 0;
+    lcd->fbRunning = true;
+
+    _refreshAttach(lcd);
+
+    CALL_EXIT(lcd);
+    return 1;
+}
+
+/********************************
+ * Stop refreshing, the screen keeps the last frame
+ ********************************/
+void LCD_fbStop(LCD_Handle lcd)
+{
+    lcd->fbRunning = false;
+    _refreshDetach(lcd);
+}
+
+/********************************
+ * The back buffer, plain RAM the application draws
+ * into with no bus traffic: fb[row][col] = 'A'
+ ********************************/
+uint8_t (*LCD_framebuffer(LCD_Handle lcd))[LCD_COLUMNS]
+{
+    return lcd->fb;
+}
+
+/********************************
+ * Publish the back buffer as the next frame
+ * Never waits on the bus. The back buffer keeps its
+ * contents, so the next frame starts from this one.
+ ********************************/
+void LCD_commit(LCD_Handle lcd)
+{
+    bool intsDisabled = Interrupt_disableMaster();
+
+    memcpy(lcd->fbFront, lcd->fb, sizeof(lcd->fbFront));
+    lcd->fbDirty = true;
+
+    if(!intsDisabled)
+    {
+        Interrupt_enableMaster();
+    }
+}
+
+/********************************
+ * Declare a field: width cells at row, col showing
+ * whatever LCD_fieldSet was last given, at most rateHz
+ * times a second. Only cells whose character changed are
+ * sent. Other LCD calls on the display are safe, the
+ * refresh waits for them, so labels can go up any time.
+ *
+ * Param: formatFxn, NULL for LCD_fieldDecimal
+ * Returns: 1 on success, 0 if it doesn't fit on screen,
+ *          the rate is out of range, the framebuffer has
+ *          the display, the bus is in blocking mode or
+ *          autoscroll is on
+ ********************************/
+int LCD_fieldInit(LCD_Handle lcd, LCD_Field * field, uint8_t row, uint8_t col, uint8_t width,
+                  LCD_FieldFormatFxn formatFxn, uint16_t rateHz)
+{
+    if(row >= LCD_ROWS || width == 0 || col + width > LCD_COLUMNS ||
+       rateHz == 0 || rateHz > LCD_REFRESH_HZ || lcd->fbRunning || !_refreshAllowed(lcd))
+    {
+        return 0;
+    }
+
+    CALL_ENTER(lcd);
+
+    // Fields are drawn at the unshifted columns
+    if(!lcd->fields)
+    {
+        LCD_home(lcd);
+    }
+
+    field->row = row;
+    field->col = col;
+    field->width = width;
+    field->formatFxn = formatFxn ? formatFxn : LCD_fieldDecimal;
+    field->interval = LCD_REFRESH_HZ / rateHz;
+    field->countdown = 0;
+    field->value = 0;
+    field->dirty = false;
+
+    bool intsDisabled = Interrupt_disableMaster();
+    field->next = lcd->fields;
+    lcd->fields = field;
+    if(!intsDisabled)
+    {
+        Interrupt_enableMaster();
+    }
+
+    _refreshAttach(lcd);
+
+    CALL_EXIT(lcd);
+    return 1;
+}
+
+/********************************
+ * Stop rendering a field, its cells keep the last value
+ ********************************/
+void LCD_fieldRemove(LCD_Handle lcd, LCD_Field * field)
+{
+    bool intsDisabled = Interrupt_disableMaster();
+
+    LCD_Field ** link = &lcd->fields;
+    while(*link && *link != field)
+    {
+        link = &(*link)->next;
+    }
+    if(*link)
+    {
+        *link = field->next;
+    }
+
+    if(!intsDisabled)
+    {
+        Interrupt_enableMaster();
+    }
+
+    _refreshDetach(lcd);
+}
+
+/********************************
+ * Any context, any rate: two stores. Values set
+ * between renders replace each other.
+ ********************************/
+void LCD_fieldSet(LCD_Field * field, int32_t value)
+{
+    field->value = value;
+    field->dirty = true;
+}
+
+/********************************
+ * Default formatter: right aligned decimal,
+ * all '#' when it doesn't fit
+ ********************************/
+void LCD_fieldDecimal(int32_t value, uint8_t * text, uint8_t width)
+{
+    uint32_t magnitude = (value < 0) ? -(uint32_t)value : (uint32_t)value;
+    int8_t i = width - 1;
+
+    do
+    {
+        text[i--] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while(magnitude && i >= 0);
+
+    if(value < 0)
+    {
+        if(i < 0)
+        {
+            magnitude = 1;
+        }
+        else
+        {
+            text[i--] = '-';
+        }
+    }
+
+    if(magnitude)
+    {
+        memset(text, '#', width);
+        return;
+    }
+
+    while(i >= 0)
+    {
+        text[i--] = ' ';
+    }
+}
+
+/********************************
+ * Timer_A0 CCR0, see the framebuffer and field notes at the top
+ * Whatever is due while the last refresh is still on
+ * the bus waits for the next tick.
+ ********************************/
+void LCD_refreshIntHandler(void)
+{
+    Timer_A_clearCaptureCompareInterrupt(REFRESH_TIMER_BASE, TIMER_A_CAPTURECOMPARE_REGISTER_0);
+
+    LCD_Handle lcd;
+    for(lcd = _refreshDisplays; lcd; lcd = lcd->refreshNext)
+    {
+        LCD_Field * field;
+
+        if(lcd->fbCountdown)
+        {
+            lcd->fbCountdown--;
+        }
+        for(field = lcd->fields; field; field = field->next)
+        {
+            if(field->countdown)
+            {
+                field->countdown--;
+            }
+        }
+
+        // A call part way through, a transfer in flight, or a
+        // read holding the bus we'd spin on
+        if(lcd->inCall || lcd->busy || !_refreshAllowed(lcd) ||
+           (lcd->bus->busy && lcd->bus->transferMode != LCD_TRANSFER_QUEUED))
+        {
+            continue;
+        }
+
+        bool sent = false;
+
+        if(lcd->fbRunning && lcd->fbCountdown == 0 && lcd->fbDirty)
+        {
+            _fbRefresh(lcd);
+            lcd->fbCountdown = lcd->fbInterval;
+            sent = true;
+        }
+
+        for(field = lcd->fields; field; field = field->next)
+        {
+            if(field->countdown == 0 && field->dirty)
+            {
+                _fieldRender(lcd, field);
+                field->countdown = field->interval;
+                sent = true;
+            }
+        }
+
+        if(sent)
+        {
+            _syncCursor(lcd);
+            _flush(lcd);
+        }
+    }
+}
+
+/********************************
+ * Queue the cells of the newest frame that changed
+ ********************************/
+static void _fbRefresh(LCD_Handle lcd)
+{
+    uint8_t frame[LCD_ROWS][LCD_COLUMNS];
+
+    // LCD_commit may be called from a higher priority interrupt
+    bool intsDisabled = Interrupt_disableMaster();
+    memcpy(frame, lcd->fbFront, sizeof(frame));
+    lcd->fbDirty = false;
+    if(!intsDisabled)
+    {
+        Interrupt_enableMaster();
+    }
+
+    uint8_t row, col;
+    for(row = 0; row < LCD_ROWS; row++)
+    {
+        for(col = 0; col < LCD_COLUMNS; col++)
+        {
+            _putCell(lcd, (row ? ROW_ADDRESS_MASK : 0) | col, frame[row][col]);
+        }
+    }
+}
+
+/********************************
+ * Queue the chars of a field's newest value that changed
+ * dirty is cleared before value is read, a set landing
+ * in between just renders again next time
+ ********************************/
+static void _fieldRender(LCD_Handle lcd, LCD_Field * field)
+{
+    field->dirty = false;
+    int32_t value = field->value;
+
+    uint8_t text[LCD_COLUMNS];
+    field->formatFxn(value, text, field->width);
+
+    uint8_t address = (field->row ? ROW_ADDRESS_MASK : 0) | field->col;
+    uint8_t i;
+    for(i = 0; i < field->width; i++)
+    {
+        _putCell(lcd, address + i, text[i]);
+    }
+}
+
+/********************************
+ * The refresh only sends from its interrupt without
+ * waiting on the bus, and only to unmoving DDRAM
+ ********************************/
+static bool _refreshAllowed(LCD_Handle lcd)
+{
+    return lcd->bus->transferMode != LCD_TRANSFER_BLOCKING &&
+           !(lcd->displayMode & LCD_ENTRYSHIFTINCREMENT);
+}
+
+/********************************
+ * Put a display on the refresh timer's list,
+ * starting the timer for the first one
+ ********************************/
+static void _refreshAttach(LCD_Handle lcd)
+{
+    bool intsDisabled = Interrupt_disableMaster();
+
+    bool timerRunning = (_refreshDisplays != NULL);
+    LCD_Handle other = _refreshDisplays;
+    while(other && other != lcd)
+    {
+        other = other->refreshNext;
+    }
+    if(!other)
+    {
+        lcd->refreshNext = _refreshDisplays;
+        _refreshDisplays = lcd;
+    }
+
+    if(!intsDisabled)
+    {
+        Interrupt_enableMaster();
+    }
+
+    if(!timerRunning)
+    {
+        Timer_A_UpModeConfig timerConfig =
+        {
+            TIMER_A_CLOCKSOURCE_ACLK,
+            TIMER_A_CLOCKSOURCE_DIVIDER_1,
+            CS_getACLK() / LCD_REFRESH_HZ,
+            TIMER_A_TAIE_INTERRUPT_DISABLE,
+            TIMER_A_CCIE_CCR0_INTERRUPT_ENABLE,
+            TIMER_A_DO_CLEAR
+        };
+        Timer_A_configureUpMode(REFRESH_TIMER_BASE, &timerConfig);
+        Interrupt_setPriority(INT_TA0_0, REFRESH_PRIORITY);
+        Interrupt_enableInterrupt(INT_TA0_0);
+        Timer_A_startCounter(REFRESH_TIMER_BASE, TIMER_A_UP_MODE);
+    }
+}
+
+/********************************
+ * Take a display off the list once it has neither a
+ * framebuffer nor fields, stopping the timer after the last.
+ * Safe on a display that was never on it.
+ ********************************/
+static void _refreshDetach(LCD_Handle lcd)
+{
+    if(lcd->fbRunning || lcd->fields)
+    {
+        return;
+    }
+
+    bool intsDisabled = Interrupt_disableMaster();
+
+    LCD_Handle * link = &_refreshDisplays;
+    while(*link && *link != lcd)
+    {
+        link = &(*link)->refreshNext;
+    }
+    if(*link)
+    {
+        *link = lcd->refreshNext;
+        lcd->refreshNext = NULL;
+
+        if(!_refreshDisplays)
+        {
+            Timer_A_stopTimer(REFRESH_TIMER_BASE);
+            Interrupt_disableInterrupt(INT_TA0_0);
+        }
+    }
+
+    if(!intsDisabled)
+    {
+        Interrupt_enableMaster();
+    }
+}
+
+/********************************
+ * Moves the controller address counter to address
+ * A set address command costs the same as one character
+ * so short gaps are cheaper to rewrite from the shadow.
+ * Not with autoscroll on, every write would shift the display.
+ ********************************/
+static void _seekAddress(LCD_Handle lcd, uint8_t address)
+{
+    if(lcd->hwAddressValid && !(lcd->displayMode & LCD_ENTRYSHIFTINCREMENT))
+    {
+        uint8_t probe = lcd->hwAddress;
+        uint8_t gap = 0;
+        while(probe != address && gap < SEEK_REWRITE_LIMIT)
+        {
+            probe = _nextAddress(lcd, probe);
+            gap++;
+        }
+
+        if(probe == address)
+        {
+            while(lcd->hwAddress != address)
+            {
+                _send(lcd, *_shadowCell(lcd, lcd->hwAddress), REG_SELECT_BIT);
+                lcd->hwAddress = _nextAddress(lcd, lcd->hwAddress);
+            }
+            return;
+        }
+    }
+
+    _send(lcd, LCD_SETDDRAMADDR | address, 0);
+    lcd->hwAddress = address;
+    lcd->hwAddressValid = true;
+}
+
+/********************************
+ * A visible cursor has to sit where the caller thinks it is
+ ********************************/
+static void _syncCursor(LCD_Handle lcd)
+{
+    if((lcd->displayControl & LCD_DISPLAYON) &&
+       (lcd->displayControl & (LCD_CURSORON | LCD_BLINKON)))
+    {
+        _seekAddress(lcd, lcd->address);
+        _flush(lcd);
+    }
+}
+
+/********************************
+ * Where the address counter goes after a write (page 10)
+ * In 2 line mode 0x27 rolls to 0x40 and 0x67 back to 0x00
+ ********************************/
+static uint8_t _nextAddress(LCD_Handle lcd, uint8_t address)
+{
+    uint8_t row = address & ROW_ADDRESS_MASK;
+    uint8_t col = address & ~ROW_ADDRESS_MASK;
+
+    if(lcd->displayMode & LCD_ENTRYLEFT)
+    {
+        if(++col < LCD_LINE_LENGTH)
+        {
+            return row | col;
+        }
+        return row ^ ROW_ADDRESS_MASK;
+    }
+
+    if(col-- > 0)
+    {
+        return row | col;
+    }
+    return (row ^ ROW_ADDRESS_MASK) | (LCD_LINE_LENGTH - 1);
+}
+
+/********************************/
+static uint8_t * _shadowCell(LCD_Handle lcd, uint8_t address)
+{
+    uint8_t row = (address & ROW_ADDRESS_MASK) ? 1 : 0;
+    uint8_t col = address & ~ROW_ADDRESS_MASK;
+
+    return &lcd->ddram[row][col % LCD_LINE_LENGTH];
+}
+
+/********************************
+ * Planner costs, see the command planner at the top
+ * One instruction is its bytes on the wire, at least
+ * the 37us it executes for
+ ********************************/
+static uint32_t _instructionUs(LCD_Handle lcd)
+{
+    LCD_Bus * bus = lcd->bus;
+    uint32_t bytes = INSTRUCTION_BYTES + bus->settleBytes;
+    uint32_t durationUs = (bytes * BITS_PER_BYTE * 1000000) / bus->config.dataRate;
+
+    return (durationUs > SETTLE_US) ? durationUs : SETTLE_US;
+}
+
+/********************************
+ * Clear and home, the command and its wait
+ ********************************/
+static uint32_t _longInstructionUs(LCD_Handle lcd)
+{
+    if(lcd->timingMode == LCD_TIMING_BUSYFLAG &&
+       lcd->bus->transferMode != LCD_TRANSFER_QUEUED)
+    {
+        return LONG_BUSY_US;
+    }
+
+    return LONG_FIXED_US;
+}
+
+/********************************
+ * Shift commands to get the display back to 0
+ * going whichever way round is shorter
+ ********************************/
+static uint8_t _unshiftSteps(LCD_Handle lcd)
+{
+    uint8_t shift = lcd->displayShift;
+
+    return (shift <= LCD_LINE_LENGTH / 2) ? shift : LCD_LINE_LENGTH - shift;
+}
+
+/********************************/
+static void _unshift(LCD_Handle lcd)
+{
+    uint8_t direction = (lcd->displayShift <= LCD_LINE_LENGTH / 2) ?
+                            LCD_MOVERIGHT : LCD_MOVELEFT;
+    uint8_t steps = _unshiftSteps(lcd);
+
+    while(steps--)
+    {
+        _send(lcd, LCD_CURSORSHIFT | LCD_DISPLAYMOVE | direction, 0);
+    }
+
+    lcd->displayShift = 0;
+}
+
+/********************************
+ * Cells that aren't blank, and how many runs they
+ * make, each run costs one set address
+ ********************************/
+static uint8_t _dirtyCells(LCD_Handle lcd, uint8_t * runs)
+{
+    uint8_t cells = 0;
+    *runs = 0;
+
+    uint8_t row, col;
+    for(row = 0; row < LCD_ROWS; row++)
+    {
+        bool inRun = false;
+        for(col = 0; col < LCD_LINE_LENGTH; col++)
+        {
+            bool dirty = lcd->ddram[row][col] != ' ';
+            if(dirty)
+            {
+                cells++;
+                if(!inRun)
+                {
+                    (*runs)++;
+                }
+            }
+            inRun = dirty;
+        }
+    }
+
+    return cells;
+}
+
+/********************************
+ * Write a space over every cell that isn't one,
+ * in the entry direction so runs need one seek
+ ********************************/
+static void _blankDirtyCells(LCD_Handle lcd)
+{
+    bool leftToRight = lcd->displayMode & LCD_ENTRYLEFT;
+
+    uint8_t row, i;
+    for(row = 0; row < LCD_ROWS; row++)
+    {
+        for(i = 0; i < LCD_LINE_LENGTH; i++)
+        {
+            uint8_t col = leftToRight ? i : LCD_LINE_LENGTH - 1 - i;
+            _putCell(lcd, (row ? ROW_ADDRESS_MASK : 0) | col, ' ');
+        }
+    }
+}
+
+/********************************
+ * Write one cell without moving the caller's
+ * cursor, skipped if the shadow already has it
+ ********************************/
+static void _putCell(LCD_Handle lcd, uint8_t address, uint8_t value)
+{
+    if(!lcd->ddramValid || *_shadowCell(lcd, address) != value)
+    {
+        _sendCell(lcd, address, value);
+    }
+}
+
+/********************************
+ * Handles the processing of display commands
+ * Not related to writing characters to screen
+ * We'll make this internal for abstraction
+ ********************************/
+static void _command(LCD_Handle lcd, uint8_t value)
+{
+    _send(lcd, value, 0);
+    _flush(lcd);
+}
+
+/********************************
+ * Processing for sending data for 4 bit mode
+ ********************************/
+static void _send(LCD_Handle lcd, uint8_t value, uint8_t mode)
+{
+    if(mode & REG_SELECT_BIT)
+    {
+        lcd->stats.data++;
+    }
+    else
+    {
+        lcd->stats.commands++;
+    }
+
+    uint8_t highnib = value & 0xf0;
+    uint8_t lownib = (value << 4) & 0xf0;
+    _write4bits(lcd, highnib | mode);
+    _write4bits(lcd, lownib | mode);
+    _padSettle(lcd, lownib | mode);
+}
+
+/********************************/
+static void _write4bits(LCD_Handle lcd, uint8_t value)
+{
+    _expanderWrite(lcd, value);
+    _pulseEnable(lcd, value);
+}
+
+/********************************
+ * Queue single byte for the I2C data line
+ * Nothing goes out until _flush()
+ ********************************/
+static void _expanderWrite(LCD_Handle lcd, uint8_t data)
+{
+    PROFILE_ENTER();
+
+    if(lcd->bus->transferMode == LCD_TRANSFER_QUEUED)
+    {
+        _queuePush(lcd, data | lcd->backlightVal);
+    }
+    else
+    {
+        if(lcd->txLength == LCD_TX_BUFFER_SIZE)
+        {
+            _flush(lcd);
+        }
+
+        lcd->txBuffer[lcd->txLength++] = data | lcd->backlightVal;
+    }
+
+    PROFILE_EXIT(LCD_PROFILE_EXPANDER_WRITE);
+}
+
+/********************************
+ * Bus time between bytes covers both delays here,
+ * see the timing model at the top of the file
+ ********************************/
+static void _pulseEnable(LCD_Handle lcd, uint8_t data)
+{
+    _expanderWrite(lcd, data | ENABLE_BIT);  // Enable bit high
+    _expanderWrite(lcd, data & ~ENABLE_BIT); // Enable bit low
+}
+
+/********************************
+ * Send every queued expander byte in one transaction
+ * In DMA and queued mode this returns as soon as it starts
+ ********************************/
+static void _flush(LCD_Handle lcd)
+{
+    LCD_Bus * bus = lcd->bus;
+
+    if(bus->transferMode == LCD_TRANSFER_QUEUED)
+    {
+        _queueKick(lcd);
+        return;
+    }
+
+    if(lcd->txLength == 0)
+    {
+        return;
+    }
+
+    if(bus->transferMode == LCD_TRANSFER_DMA)
+    {
+        _dmaStart(lcd, lcd->txBuffer, lcd->txLength);
+
+        // Fill the other buffer while this one goes out
+        lcd->txBuffer = (lcd->txBuffer == lcd->txBuffers[0]) ?
+                            lcd->txBuffers[1] : lcd->txBuffers[0];
+        lcd->txLength = 0;
+        return;
+    }
+
+    I2C_setSlaveAddress(bus->base, lcd->slaveAddress);
+
+    if(lcd->txLength == 1)
+    {
+        I2C_masterSendSingleByte(bus->base, lcd->txBuffer[0]);
+    }
+    else
+    {
+        I2C_masterSendMultiByteStart(bus->base, lcd->txBuffer[0]);
+
+        uint16_t i;
+        for(i = 1; i < lcd->txLength - 1; i++)
+        {
+            I2C_masterSendMultiByteNext(bus->base, lcd->txBuffer[i]);
+        }
+
+        I2C_masterSendMultiByteFinish(bus->base, lcd->txBuffer[lcd->txLength - 1]);
+    }
+
+    // Last byte and STOP are still shifting out
+    lcd->lastEdge = _now() + 2 * bus->byteTicks;
+
+    lcd->stats.transactions++;
+    lcd->stats.bytes += lcd->txLength;
+    if(I2C_getInterruptStatus(bus->base, EUSCI_B_I2C_NAK_INTERRUPT))
+    {
+        I2C_clearInterruptFlag(bus->base, EUSCI_B_I2C_NAK_INTERRUPT);
+        _transferLost(lcd);
+    }
+
+    lcd->txLength = 0;
+}
+
+/********************************
+ * The expander NACKed, the rest of the transfer never
+ * reached the LCD. Nothing we think it shows can be
+ * trusted: the next seek sets the address and every cell
+ * is sent until a clear makes the shadow true again.
+ ********************************/
+static void _transferLost(LCD_Handle lcd)
+{
+    lcd->stats.nacks++;
+    lcd->hwAddressValid = false;
+    lcd->ddramValid = false;
+}
+
+/********************************
+ * Wait for everything queued so far to reach the
+ * LCD, then hold off for the given settle time
+ ********************************/
+static void _wait(LCD_Handle lcd, uint32_t durationUs)
+{
+    if(lcd->bus->transferMode == LCD_TRANSFER_QUEUED)
+    {
+        _queueDelay(lcd, durationUs);
+        _queueKick(lcd);
+        return;
+    }
 
-// I2C Master Configuration
-const eUSCI_I2C_MasterConfig i2cConfig =
-{
-        EUSCI_B_I2C_CLOCKSOURCE_SMCLK,          // SMCLK Clock Source
-        CLOCK_FREQ,                             // Set the Clock Frequency
-        EUSCI_B_I2C_SET_DATA_RATE_100KBPS,      // Desired I2C Clock of 100KHz
-        0,                                      // No byte counter threshold
-        EUSCI_B_I2C_NO_AUTO_STOP                // No Autostop
-};
+    LCD_waitIdle(lcd);
+
+    if(lcd->timingMode == LCD_TIMING_BUSYFLAG)
+    {
+        _waitBusyFlag(lcd, durationUs);
+    }
+    else
+    {
+        _settle(lcd, durationUs);
+    }
+}
 
 /********************************
- * We want to use the TIMER32 on the MSP432
- * because this will allow us to use the same
- * code with different clock frequencies easily
+ * Choose how long commands are waited on
  *
- * Changes made to the TIMER32 could affect the LCD
+ * LCD_TIMING_FIXED: worst case datasheet delays
+ * LCD_TIMING_BUSYFLAG: poll the busy flag, never
+ *                      longer than the fixed delay
+ *
+ * Busy flag needs R/W wired to the expander. We read the
+ * status once and stay on fixed delays if it doesn't
+ * make sense. Queued mode always uses fixed delays.
+ *
+ * Returns: 1 on success, 0 otherwise
  ********************************/
-static void _delayInit(void)
+int LCD_setTimingMode(LCD_Handle lcd, uint8_t mode)
 {
-    Timer32_initModule(TIMER32_BASE, TIMER32_PRESCALER_1,
-                           TIMER32_32BIT, TIMER32_PERIODIC_MODE);
-}
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
 
-static void _delayMicroseconds(uint32_t durationUs)
-{
-    durationUs = durationUs * (CLOCK_FREQ / 1000000);
+    if(mode == LCD_TIMING_BUSYFLAG)
+    {
+        // Reads need the bus to ourselves
+        if(lcd->bus->transferMode == LCD_TRANSFER_QUEUED)
+        {
+            CALL_EXIT(lcd);
+            PROFILE_RETURN(LCD_PROFILE_SET_TIMING_MODE, 0);
+        }
+
+        LCD_waitIdle(lcd);
 
-    Timer32_setCount(TIMER32_BASE, durationUs);
-    Timer32_startTimer(TIMER32_BASE, true);
+        // Write-only modules read back all ones (busy forever)
+        uint8_t status = _readStatus(lcd);
+        if((status & BUSY_FLAG) ||
+           (lcd->hwAddressValid && status != lcd->hwAddress))
+        {
+            _resyncAddress(lcd);
+            CALL_EXIT(lcd);
+            PROFILE_RETURN(LCD_PROFILE_SET_TIMING_MODE, 0);
+        }
+    }
 
-    while(Timer32_getValue(TIMER32_BASE) != 0);
+    lcd->timingMode = mode;
 
-    Timer32_haltTimer(TIMER32_BASE);
+    CALL_EXIT(lcd);
+    PROFILE_RETURN(LCD_PROFILE_SET_TIMING_MODE, 1);
 }
 
 /********************************
- * Initializes the I2C EUSCI_B0 on the MSP432
- * Pin 1.6 = SDA (Data)
- * Pin 1.7 = SCL (Clock)
+ * Poll until the busy flag drops or timeoutUs passes
  ********************************/
-static void _i2cInit(uint8_t slaveAddress)
+static void _waitBusyFlag(LCD_Handle lcd, uint32_t timeoutUs)
 {
-    // Selects Port 1 for I2c (1.6 = SDA, 1.7 = SCL)
-    GPIO_setAsPeripheralModuleFunctionInputPin(GPIO_PORT_P1,
-            GPIO_PIN6 + GPIO_PIN7, GPIO_PRIMARY_MODULE_FUNCTION);
-
-    // Initialize based on config
-    I2C_initMaster(EUSCI_B0_BASE, &i2cConfig);
+    // Status reads move lastEdge, time out from the command itself
+    uint32_t start = lcd->lastEdge;
+    uint32_t ticks = _usToTicks(timeoutUs);
 
-    // Specify slave address of LCD
-    I2C_setSlaveAddress(EUSCI_B0_BASE, slaveAddress);
+    while((int32_t)(_now() - start) < (int32_t)ticks &&
+          (_readStatus(lcd) & BUSY_FLAG));
+}
 
-    // Set master in transmit mode
-    I2C_setMode(EUSCI_B0_BASE, EUSCI_B_I2C_TRANSMIT_MODE);
+/********************************
+ * Without R/W wired a status read is two writes with RS
+ * low and D7-D4 high: instruction 0xFF, set DDRAM address
+ * 0x7F. Let it execute, then put the address counter back.
+ ********************************/
+static void _resyncAddress(LCD_Handle lcd)
+{
+    _wait(lcd, SETTLE_US);
 
-    // Enable to start operation
-    I2C_enableModule(EUSCI_B0_BASE);
+    lcd->hwAddressValid = false;
+    _seekAddress(lcd, lcd->address);
+    _flush(lcd);
 }
 
 /********************************
- * Code created according to the data sheet (page 45/46)
- * https://www.sparkfun.com/datasheets/LCD/HD44780.pdf
+ * Read busy flag and address counter (page 24)
  *
- * Param: Slave address of LCD
- * Returns: 1 on success, 0 otherwise
+ * In 4 bit mode both nibbles have to be clocked out
+ * BF/AC6-4 come in on P7-P4, then AC3-0
  ********************************/
-int LCD_init(uint8_t slaveAddress)
+static uint8_t _readStatus(LCD_Handle lcd)
 {
-    // Make sure the CLOCK_FREQ definition matches actual clock frequency
-    uint32_t clockFreq = CS_getSMCLK();
-    if(CLOCK_FREQ != clockFreq)
-    {
-        // Failed
-        return 0;
-    }
-
-    _i2cInit(slaveAddress);
-    _delayInit();
+    uint8_t readPins = READ_DATA_PINS | READ_WRITE_BIT;
 
-    // Default display, text direction, and back light
-    uint8_t displayFunction = LCD_4BITMODE | LCD_2LINE | LCD_5x8DOTS;
-    _displayMode = LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT;
-    _backlightVal = LCD_BACKLIGHT;
+    // High nibble: BF and AC6-4
+    _expanderWrite(lcd, readPins);
+    _expanderWrite(lcd, readPins | ENABLE_BIT);
+    LCD_waitIdle(lcd);
+    uint8_t high = _expanderRead(lcd);
 
-    // We need at least 40ms after power rises above 2.7V
-    _delayMicroseconds(50 * 1000);
+    // Low nibble: AC3-0
+    _expanderWrite(lcd, readPins);
+    _expanderWrite(lcd, readPins | ENABLE_BIT);
+    LCD_waitIdle(lcd);
+    uint8_t low = _expanderRead(lcd);
 
-    // Now we pull both RS and R/W low to begin commands
-    _expanderWrite(_backlightVal);
+    _expanderWrite(lcd, readPins);
+    LCD_waitIdle(lcd);
 
-    // We start in 8 bit mode, try to set 4 bit mode
-    _write4bits(0x03 << 4);
-    _delayMicroseconds(45 * 100); // Wait more than 4.1ms
+    return (high & 0xF0) | (low >> 4);
+}
 
-    // Second try
-    _write4bits(0x03 << 4);
-    _delayMicroseconds(150); // Wait more than 100us
+/********************************
+ * One byte from the expander's pins
+ ********************************/
+static uint8_t _expanderRead(LCD_Handle lcd)
+{
+    _busClaim(lcd);
+    uint8_t pins = I2C_masterReceiveSingleByte(lcd->bus->base);
+    lcd->stats.transactions++;
+    _busRelease(lcd);
 
-    // Third try
-    _write4bits(0x03 << 4);
+    return pins;
+}
 
-    // Finally, set to 4-bit interface
-    _write4bits(0x02 << 4);
+/********************************
+ * Choose how flushed bytes reach the bus
+ * This applies to every display on lcd's bus
+ *
+ * LCD_TRANSFER_BLOCKING: CPU feeds EUSCI_B byte by byte
+ * LCD_TRANSFER_DMA: uDMA feeds EUSCI_B, calls return early
+ * LCD_TRANSFER_QUEUED: every call, settle delays included,
+ *                      is queued and drained by interrupts,
+ *                      displays take turns on the bus
+ *
+ * DMA mode needs LCD_dmaBxIntHandler on DMA_INT1 (B0) or
+ * DMA_INT2 (B1), queued mode needs LCD_timerIntHandler on
+ * T32_INT2, and both need LCD_i2cBxIntHandler on EUSCIBx.
+ * LCD calls must not be made from an interrupt that can
+ * block those.
+ ********************************/
+void LCD_setTransferMode(LCD_Handle lcd, uint8_t mode)
+{
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
 
-    // Set number of lines, font size...
-    _command(LCD_FUNCTIONSET | displayFunction);
+    LCD_Bus * bus = lcd->bus;
 
-    // Turn the display on with blinking cursor for default
-    _displayControl = LCD_DISPLAYON | LCD_CURSORON | LCD_BLINKON;
-    LCD_displayOn();
+    _busWaitIdle(bus);
 
-    // Clear it off
-    LCD_clear();
+    if(mode == LCD_TRANSFER_DMA && !bus->dmaReady)
+    {
+        _dmaInit(bus);
+    }
 
-    // Set the entry mode
-    _command(LCD_ENTRYMODESET | _displayMode);
+    if(mode == LCD_TRANSFER_QUEUED)
+    {
+        _queueInit(bus);
+    }
 
-    // Set cursor to start position
-    LCD_home();
+    bus->transferMode = mode;
 
-    return 1;
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_SET_TRANSFER_MODE);
 }
 
 /********************************
- * Clear display and set cursor position to zero
- * This command takes a long time (delay needed)
+ * Returns 1 while a transfer or queued work is pending
  ********************************/
-void LCD_clear(void)
+int LCD_isBusy(LCD_Handle lcd)
 {
-    _command(LCD_CLEARDISPLAY);
-    _delayMicroseconds(45 * 100);
+    if(lcd->busy || LCD_queueLevel(lcd) != 0)
+    {
+        return 1;
+    }
+
+    return 0;
 }
 
 /********************************
- * Set cursor position to zero
- * This command takes a long time (delay needed)
+ * Blocks until everything written so far is on the LCD
+ * including any queued settle delays
  ********************************/
-void LCD_home(void)
+void LCD_waitIdle(LCD_Handle lcd)
 {
-    _command(LCD_RETURNHOME);
-    _delayMicroseconds(45 * 100);
+    PROFILE_ENTER();
+    CALL_ENTER(lcd);
+
+    _flush(lcd);
+    while(LCD_isBusy(lcd));
+
+    CALL_EXIT(lcd);
+    PROFILE_EXIT(LCD_PROFILE_WAIT_IDLE);
 }
 
 /********************************
- * Turn the display on or off
- * This isn't the same as turning on/off the backlight
+ * Returns how many queue entries are in use
+ * Each character or command takes 6, out of LCD_QUEUE_SIZE
  ********************************/
-void LCD_displayOn(void)
+uint16_t LCD_queueLevel(LCD_Handle lcd)
 {
-    _displayControl |= LCD_DISPLAYON;
-    _command(LCD_DISPLAYCONTROL | _displayControl);
+    return (lcd->queueHead - lcd->queueTail) & QUEUE_MASK;
 }
 
-void LCD_displayOff(void)
+/********************************
+ * doneFxn is called from interrupt context every time
+ * a DMA transfer for lcd finishes or its queue drains
+ * (NULL to disable)
+ ********************************/
+void LCD_setTransferDoneFxn(LCD_Handle lcd, void (*doneFxn)(LCD_Handle lcd))
 {
-    _displayControl &= ~LCD_DISPLAYON;
-    _command(LCD_DISPLAYCONTROL | _displayControl);
+    lcd->transferDoneFxn = doneFxn;
 }
 
 /********************************
- * Set the location of the cursor assuming 16x2 LCD
- * Numbering is based on zero indexed arrays
- * For example, rows are 0 or 1 (top or bottom)
+ * Snapshot of the counters, safe against the
+ * interrupts that update them
  ********************************/
-int LCD_setCursorPosition(uint8_t row, uint8_t col)
+void LCD_getStats(LCD_Handle lcd, LCD_Stats * stats)
 {
-   // Sanity check row and columns...
-   // No need to check less than 0 on unsigned byte
-   if(row > 1 || col > 16)
-   {
-       return 0;
-   }
+    bool intsDisabled = Interrupt_disableMaster();
 
-   int row_offsets[] = { 0x00, 0x40 };
-   _command(LCD_SETDDRAMADDR | (col + row_offsets[row]));
+    *stats = lcd->stats;
 
-   return 1;
+    if(!intsDisabled)
+    {
+        Interrupt_enableMaster();
+    }
 }
 
-/********************************
- * Display or hide the cursor
- ********************************/
-void LCD_cursorOn(void)
+/********************************/
+void LCD_resetStats(LCD_Handle lcd)
 {
-    _displayControl |= LCD_CURSORON;
-    _command(LCD_DISPLAYCONTROL | _displayControl);
+    bool intsDisabled = Interrupt_disableMaster();
+
+    memset(&lcd->stats, 0, sizeof(LCD_Stats));
+
+    if(!intsDisabled)
+    {
+        Interrupt_enableMaster();
+    }
 }
 
-void LCD_cursorOff(void)
+/********************************/
+static void _transferDone(LCD_Handle lcd)
 {
-    _displayControl &= ~LCD_CURSORON;
-    _command(LCD_DISPLAYCONTROL | _displayControl);
+    lcd->busy = false;
+
+    if(lcd->transferDoneFxn)
+    {
+        lcd->transferDoneFxn(lcd);
+    }
 }
 
 /********************************
- * Turn blinking cursor on/off
+ * The bus channel copies one byte into TXBUF every time
+ * EUSCI_Bx raises TXIFG0, completion goes to DMA_INTx
  ********************************/
-void LCD_blinkOn(void)
+static void _dmaInit(LCD_Bus * bus)
 {
-    _displayControl |= LCD_BLINKON;
-    _command(LCD_DISPLAYCONTROL | _displayControl);
+    if(!_dmaModuleReady)
+    {
+        DMA_enableModule();
+        DMA_setControlBase(_dmaControlTable);
+        _dmaModuleReady = true;
+    }
+
+    DMA_assignChannel(bus->dmaChannel);
+    DMA_setChannelControl(UDMA_PRI_SELECT | bus->dmaChannel,
+            UDMA_SIZE_8 | UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_1);
+
+    DMA_assignInterrupt(bus->dmaInterrupt, bus->dmaChannelNum);
+    DMA_clearInterruptFlag(bus->dmaChannelNum);
+    Interrupt_enableInterrupt(bus->dmaIntNum);
+    Interrupt_enableInterrupt(bus->interrupt);
+
+    bus->dmaReady = true;
 }
 
-void LCD_blinkOff(void)
+/********************************
+ * Arm the channel then send START, the first TXIFG0
+ * after the address is acknowledged kicks things off
+ ********************************/
+static void _dmaStart(LCD_Handle lcd, uint8_t * buffer, uint16_t length)
 {
-    _displayControl &= ~LCD_BLINKON;
-    _command(LCD_DISPLAYCONTROL | _displayControl);
+    LCD_Bus * bus = lcd->bus;
+
+    while(bus->busy);
+    bus->busy = true;
+    bus->active = lcd;
+    lcd->busy = true;
+    lcd->stats.transactions++;
+    lcd->stats.bytes += length;
+
+    I2C_setSlaveAddress(bus->base, lcd->slaveAddress);
+
+    DMA_setChannelTransfer(UDMA_PRI_SELECT | bus->dmaChannel, UDMA_MODE_BASIC,
+            buffer, (void *)(uintptr_t)I2C_getTransmitBufferAddressForDMA(bus->base),
+            length);
+    DMA_enableChannel(bus->dmaChannelNum);
+
+    I2C_clearInterruptFlag(bus->base,
+            EUSCI_B_I2C_STOP_INTERRUPT | EUSCI_B_I2C_NAK_INTERRUPT);
+    I2C_enableInterrupt(bus->base,
+            EUSCI_B_I2C_STOP_INTERRUPT | EUSCI_B_I2C_NAK_INTERRUPT);
+
+    // Status reads leave the module in receive mode
+    I2C_setMode(bus->base, EUSCI_B_I2C_TRANSMIT_MODE);
+    I2C_masterSendStart(bus->base);
 }
 
 /********************************
- * Shifts the text on display 1 position to right or left
- * These functions will wrap text (they'll come out other side)
+ * Triggered on DMA_INT1 (B0) or DMA_INT2 (B1) when the
+ * last byte is in TXBUF. STOP can go out once it moves
+ * to the shift register.
  ********************************/
-void LCD_shiftDisplayLeft(void)
+void LCD_dmaB0IntHandler(void)
+{
+    _dmaIntHandler(&_buses[0]);
+}
+
+void LCD_dmaB1IntHandler(void)
 {
-    _command(LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVELEFT);
+    _dmaIntHandler(&_buses[1]);
 }
 
-void LCD_shiftDisplayRight(void)
+static void _dmaIntHandler(LCD_Bus * bus)
 {
-    _command(LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVERIGHT);
+    DMA_clearInterruptFlag(bus->dmaChannelNum);
+    I2C_enableInterrupt(bus->base, EUSCI_B_I2C_TRANSMIT_INTERRUPT0);
 }
 
 /********************************
- * Set the direction or writing text to
- * left -> right or right -> left
- *
- * Default is left to right
+ * Triggered on EUSCI_B0/EUSCI_B1 interrupts
  ********************************/
-void LCD_textLeftToRight(void)
+void LCD_i2cB0IntHandler(void)
 {
-    _displayMode |= LCD_ENTRYLEFT;
-    _command(LCD_ENTRYMODESET | _displayMode);
+    _i2cIntHandler(&_buses[0]);
 }
 
-void LCD_textRightToLeft(void)
+void LCD_i2cB1IntHandler(void)
 {
-    _displayMode &= ~LCD_ENTRYLEFT;
-    _command(LCD_ENTRYMODESET | _displayMode);
+    _i2cIntHandler(&_buses[1]);
 }
 
 /********************************
- * This will right justify text if on
- * Or left justify if off
+ * EUSCI_B interrupts during DMA transfers
+ * TX0: last byte is shifting out, send STOP
+ * NAK: expander didn't answer, abandon the transfer
+ * STOP: transfer is over
  ********************************/
-void LCD_autoscrollOn(void)
+static void _i2cIntHandler(LCD_Bus * bus)
 {
-    _displayMode |= LCD_ENTRYSHIFTINCREMENT;
-    _command(LCD_ENTRYMODESET | _displayMode);
+    uint_fast16_t intStatus = I2C_getEnabledInterruptStatus(bus->base);
+    I2C_clearInterruptFlag(bus->base, intStatus);
+
+    if(bus->transferMode == LCD_TRANSFER_QUEUED)
+    {
+        _queueIntHandler(bus, intStatus);
+        return;
+    }
+
+    if(intStatus & EUSCI_B_I2C_NAK_INTERRUPT)
+    {
+        _transferLost(bus->active);
+        DMA_disableChannel(bus->dmaChannelNum);
+        EUSCI_B_CMSIS(bus->base)->CTLW0 |= EUSCI_B_CTLW0_TXSTP;
+    }
+
+    if(intStatus & EUSCI_B_I2C_TRANSMIT_INTERRUPT0)
+    {
+        I2C_disableInterrupt(bus->base, EUSCI_B_I2C_TRANSMIT_INTERRUPT0);
+        EUSCI_B_CMSIS(bus->base)->CTLW0 |= EUSCI_B_CTLW0_TXSTP;
+    }
+
+    if(intStatus & EUSCI_B_I2C_STOP_INTERRUPT)
+    {
+        I2C_disableInterrupt(bus->base,
+                EUSCI_B_I2C_STOP_INTERRUPT | EUSCI_B_I2C_NAK_INTERRUPT);
+
+        LCD_Handle lcd = bus->active;
+        lcd->lastEdge = _now();
+        bus->busy = false;
+        _transferDone(lcd);
+    }
 }
 
-void LCD_autoscrollOff(void)
+/********************************
+ * TIMER32_1 wakes the buses when queued settle delays
+ * end, TIMER32_0 stays with _delayMicroseconds
+ ********************************/
+static void _queueInit(LCD_Bus * bus)
 {
-    _displayMode &= ~LCD_ENTRYSHIFTINCREMENT;
-    _command(LCD_ENTRYMODESET | _displayMode);
+    if(!_queueTimerReady)
+    {
+        Timer32_initModule(QUEUE_TIMER_BASE, TIMER32_PRESCALER_1,
+                               TIMER32_32BIT, TIMER32_PERIODIC_MODE);
+        Timer32_enableInterrupt(QUEUE_TIMER_BASE);
+        Interrupt_enableInterrupt(INT_T32_INT2);
+        _queueTimerReady = true;
+    }
+
+    Interrupt_enableInterrupt(bus->interrupt);
 }
 
 /********************************
- * Turn the back light on or off
- * Default is on
+ * Blocks only while the queue is full
  ********************************/
-void LCD_backlightOn(void)
+static void _queuePush(LCD_Handle lcd, uint16_t entry)
 {
-    _backlightVal = LCD_BACKLIGHT;
-    _expanderWrite(0);
+    while(LCD_queueLevel(lcd) == QUEUE_MASK)
+    {
+        _queueKick(lcd);
+    }
+
+    lcd->queue[lcd->queueHead] = entry;
+    lcd->queueHead = (lcd->queueHead + 1) & QUEUE_MASK;
 }
 
-void LCD_backlightOff(void)
+/********************************/
+static void _queueDelay(LCD_Handle lcd, uint32_t durationUs)
 {
-    _backlightVal = LCD_NOBACKLIGHT;
-    _expanderWrite(0);
+    while(durationUs > QUEUE_MAX_DELAY)
+    {
+        _queuePush(lcd, QUEUE_DELAY | QUEUE_MAX_DELAY);
+        durationUs -= QUEUE_MAX_DELAY;
+    }
+
+    _queuePush(lcd, QUEUE_DELAY | durationUs);
 }
 
 /********************************
- * Returns 1 if back light is on, 0 if off
+ * Start draining if the bus has gone idle
+ * Interrupts are held off so the ISR can't go idle
+ * between our check and our start. Interrupt_disableMaster
+ * returns true if they were off already, leave them off then.
  ********************************/
-int LCD_isBacklightOn(void)
+static void _queueKick(LCD_Handle lcd)
 {
-    if(_backlightVal == LCD_BACKLIGHT)
+    bool intsDisabled = Interrupt_disableMaster();
+
+    if(LCD_queueLevel(lcd) != 0)
     {
-        return 1;
+        lcd->busy = true;
+
+        if(!lcd->bus->busy)
+        {
+            _queueService(lcd->bus);
+        }
     }
 
-    return 0;
+    if(!intsDisabled)
+    {
+        Interrupt_enableMaster();
+    }
 }
 
 /********************************
- * We can create and store up to 8 custom characters to CGRAM
- * Look at data sheet starting at page 13
- *
- * memAddress: Location in EEPROM (0 - 7)
- * charMap: Array of uint8 that represent custom character
- * Only the 5 least significant bits are looked at
- *
- * Example using a heart :
- * uint8_t heart[CHAR_HEIGHT] = { 0x00, 0x0A, 0x1F, 0x1F, 0x0E, 0x04, 0x00 };
- * [ 0 0 0 0 0      -> 0x00 = 0b00000
- *   0 1 0 1 0      -> 0x0A = 0b01010
- *   1 1 1 1 1      -> 0x1F = 0b11111
- *   1 1 1 1 1      -> 0x1F = 0b11111
- *   0 1 1 1 0      -> 0x0E = 0b01110
- *   0 0 1 0 0      -> 0x04 = 0b00100
- *   0 0 0 0 0 ]    -> 0x00 = 0b00000
- *   0 0 0 0 0 (Cursor)
- *
- *   Last row of bits (8th row) is dedicated to cursor
- *   Custom char generator: https://omerk.github.io/lcdchargen/
- *
+ * Runs while the bus is idle: retire finished settle
+ * delays, then start a transaction for the next display
+ * (round robin) that has bytes and isn't settling.
+ * If everyone is settling, arm TIMER32_1 and go idle.
  ********************************/
-int LCD_createChar(uint8_t memAddress, uint8_t charMap[])
+static void _queueService(LCD_Bus * bus)
 {
-    // Sanity check that address is between 0 - 7
-    if(memAddress > 7)
+    if(!bus->displays)
     {
-        // Failed
-        return 0;
+        return;
     }
 
-    // Send mask of CGRAM address and location shifted 3 bits (page 19)
-    _command(LCD_SETCGRAMADDR | (memAddress << 3));
+    uint32_t now = _now();
+    LCD_Handle start = bus->cursor ? bus->cursor : bus->displays;
+    LCD_Handle lcd = start;
+    bool anyWaiting = false;
+
+    do
+    {
+        // Turn delays at the head of the queue into deadlines
+        while(true)
+        {
+            if(lcd->waiting)
+            {
+                if((int32_t)(now - lcd->readyAt) < 0)
+                {
+                    break;
+                }
+
+                lcd->lastEdge = lcd->readyAt;
+                lcd->waiting = false;
+            }
+
+            if(lcd->queueTail == lcd->queueHead ||
+               !(lcd->queue[lcd->queueTail] & QUEUE_DELAY))
+            {
+                break;
+            }
+
+            uint16_t entry = lcd->queue[lcd->queueTail];
+            lcd->queueTail = (lcd->queueTail + 1) & QUEUE_MASK;
+            lcd->readyAt = lcd->lastEdge + _usToTicks(entry & QUEUE_MAX_DELAY);
+            lcd->waiting = true;
+        }
+
+        if(lcd->waiting)
+        {
+            anyWaiting = true;
+        }
+        else if(lcd->queueTail != lcd->queueHead)
+        {
+            _queueStart(bus, lcd);
+            return;
+        }
+        else if(lcd->busy)
+        {
+            _transferDone(lcd);
+        }
+
+        lcd = lcd->next ? lcd->next : bus->displays;
+    } while(lcd != start);
+
+    bus->busy = false;
+
+    if(anyWaiting)
+    {
+        _queueArmTimer();
+    }
+}
+
+/********************************/
+static void _queueStart(LCD_Bus * bus, LCD_Handle lcd)
+{
+    bus->busy = true;
+    bus->active = lcd;
+    bus->burstCount = 0;
+    bus->cursor = lcd->next;
+    lcd->stats.transactions++;
+
+    I2C_setSlaveAddress(bus->base, lcd->slaveAddress);
+
+    I2C_clearInterruptFlag(bus->base,
+            EUSCI_B_I2C_STOP_INTERRUPT | EUSCI_B_I2C_NAK_INTERRUPT);
+    I2C_enableInterrupt(bus->base, EUSCI_B_I2C_TRANSMIT_INTERRUPT0 |
+            EUSCI_B_I2C_STOP_INTERRUPT | EUSCI_B_I2C_NAK_INTERRUPT);
+
+    // Status reads leave the module in receive mode
+    I2C_setMode(bus->base, EUSCI_B_I2C_TRANSMIT_MODE);
+    I2C_masterSendStart(bus->base);
+}
+
+/********************************
+ * Point TIMER32_1 at the earliest pending deadline on
+ * any idle bus
+ ********************************/
+static void _queueArmTimer(void)
+{
+    uint32_t now = _now();
+    int32_t earliest = INT32_MAX;
 
-    // Write each line of bits
     int i;
-    for(i = 0; i < CHAR_HEIGHT; i++)
+    for(i = 0; i < BUS_COUNT; i++)
     {
-        LCD_writeChar(charMap[i]);
+        if(_buses[i].busy)
+        {
+            continue;
+        }
+
+        LCD_Handle lcd;
+        for(lcd = _buses[i].displays; lcd; lcd = lcd->next)
+        {
+            int32_t remaining = (int32_t)(lcd->readyAt - now);
+            if(lcd->waiting && remaining < earliest)
+            {
+                earliest = remaining;
+            }
+        }
     }
 
-    return 1;
+    if(earliest == INT32_MAX)
+    {
+        return;
+    }
+
+    Timer32_setCount(QUEUE_TIMER_BASE, (earliest > 0) ? earliest : 1);
+    Timer32_startTimer(QUEUE_TIMER_BASE, true);
 }
 
 /********************************
- * Writes a single character to the LCD
- * Wraps the cursor if position isn't on screen
+ * EUSCI_B interrupts in queued mode
+ * TX0: send the next byte, or STOP at a delay, an empty
+ *      queue or the burst limit
+ * NAK: drop the rest of this transaction so we can't spin
+ * STOP: bus is free, see who's next
  ********************************/
-void LCD_writeChar(uint8_t value)
+static void _queueIntHandler(LCD_Bus * bus, uint_fast16_t intStatus)
 {
-    _send(value, REG_SELECT_BIT);
+    LCD_Handle lcd = bus->active;
+
+    if(intStatus & EUSCI_B_I2C_NAK_INTERRUPT)
+    {
+        _transferLost(lcd);
+        while(lcd->queueTail != lcd->queueHead &&
+              !(lcd->queue[lcd->queueTail] & QUEUE_DELAY))
+        {
+            lcd->queueTail = (lcd->queueTail + 1) & QUEUE_MASK;
+        }
+
+        I2C_disableInterrupt(bus->base, EUSCI_B_I2C_TRANSMIT_INTERRUPT0);
+        EUSCI_B_CMSIS(bus->base)->CTLW0 |= EUSCI_B_CTLW0_TXSTP;
+    }
+    else if(intStatus & EUSCI_B_I2C_TRANSMIT_INTERRUPT0)
+    {
+        if(lcd->queueTail != lcd->queueHead &&
+           !(lcd->queue[lcd->queueTail] & QUEUE_DELAY) &&
+           bus->burstCount < QUEUE_BURST_LIMIT)
+        {
+            I2C_masterSendMultiByteNext(bus->base, (uint8_t)lcd->queue[lcd->queueTail]);
+            lcd->queueTail = (lcd->queueTail + 1) & QUEUE_MASK;
+            bus->burstCount++;
+            lcd->stats.bytes++;
+        }
+        else
+        {
+            I2C_disableInterrupt(bus->base, EUSCI_B_I2C_TRANSMIT_INTERRUPT0);
+            EUSCI_B_CMSIS(bus->base)->CTLW0 |= EUSCI_B_CTLW0_TXSTP;
+        }
+    }
+
+    if(intStatus & EUSCI_B_I2C_STOP_INTERRUPT)
+    {
+        I2C_disableInterrupt(bus->base,
+                EUSCI_B_I2C_STOP_INTERRUPT | EUSCI_B_I2C_NAK_INTERRUPT);
+        lcd->lastEdge = _now();
+        bus->busy = false;
+        _queueService(bus);
+    }
 }
 
 /********************************
- * Writes a string to the LCD
+ * Triggered on T32_INT2 when a queued settle delay ends
  ********************************/
-void LCD_writeString(uint8_t * charBuffer, uint8_t numChars)
+void LCD_timerIntHandler(void)
 {
+    Timer32_clearInterruptFlag(QUEUE_TIMER_BASE);
+
     int i;
-    for(i = 0; i < numChars; i++)
+    for(i = 0; i < BUS_COUNT; i++)
     {
-        LCD_writeChar(charBuffer[i]);
+        if(_buses[i].transferMode == LCD_TRANSFER_QUEUED && !_buses[i].busy)
+        {
+            _queueService(&_buses[i]);
+        }
     }
 }
 
+#ifdef LCD_PROFILE
 /********************************
- * Handles the processing of display commands
- * Not related to writing characters to screen
- * We'll make this internal for abstraction
+ * Turns the cycle counter on the first time through
  ********************************/
-static void _command(uint8_t value)
+static uint32_t _profileStart(void)
+{
+    if(!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk))
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+
+    return DWT->CYCCNT;
+}
+
+/********************************/
+static void _profileRecord(uint8_t id, uint32_t start)
 {
-    _send(value, 0);
+    uint32_t cycles = DWT->CYCCNT - start;
+    LCD_Profile * profile = &_profiles[id];
+
+    uint8_t bucket = 32 - __CLZ(cycles);
+    if(bucket >= LCD_PROFILE_BUCKETS)
+    {
+        bucket = LCD_PROFILE_BUCKETS - 1;
+    }
+
+    profile->buckets[bucket]++;
+    profile->count++;
+    if(cycles > profile->max)
+    {
+        profile->max = cycles;
+    }
 }
 
 /********************************
- * Processing for sending data for 4 bit mode
+ * Histogram for one LCD_PROFILE_* id
  ********************************/
-static void _send(uint8_t value, uint8_t mode)
+const LCD_Profile * LCD_getProfile(uint8_t id)
 {
-    uint8_t highnib = value & 0xf0;
-    uint8_t lownib = (value << 4) & 0xf0;
-    _write4bits(highnib | mode);
-    _write4bits(lownib | mode);
+    return &_profiles[id];
 }
 
 /********************************/
-static void _write4bits(uint8_t value)
+const char * LCD_profileName(uint8_t id)
 {
-    _expanderWrite(value);
-    _pulseEnable(value);
+    return _profileNames[id];
 }
 
 /********************************
- * Write single byte to I2C data line
+ * Upper bound in cycles of the bucket the
+ * given percentile (1 - 100) falls in
  ********************************/
-static void _expanderWrite(uint8_t data)
+uint32_t LCD_profilePercentile(const LCD_Profile * profile, uint8_t percent)
 {
-    I2C_masterSendSingleByte(EUSCI_B0_BASE, data | _backlightVal);
+    uint32_t target = ((uint64_t)profile->count * percent + 99) / 100;
+    uint32_t seen = 0;
+
+    uint8_t bucket;
+    for(bucket = 0; bucket < LCD_PROFILE_BUCKETS; bucket++)
+    {
+        seen += profile->buckets[bucket];
+        if(seen >= target && seen > 0)
+        {
+            return (bucket == 0) ? 0 : (uint32_t)((1ull << bucket) - 1);
+        }
+    }
+
+    return 0;
 }
 
 /********************************/
-static void _pulseEnable(uint8_t data)
+void LCD_resetProfile(void)
 {
-    _expanderWrite(data | ENABLE_BIT);  // Enable bit high
-    _delayMicroseconds(1);              // Enable pulse must be >450ns
-
-    _expanderWrite(data & ~ENABLE_BIT); // Enable bit low
-    _delayMicroseconds(50);             // Command needs >37us to settle
+    memset(_profiles, 0, sizeof(_profiles));
 }
+#endif
@@ -9,9 +9,16 @@
 #ifndef I2C_LCD_H_
 #define I2C_LCD_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #define CHAR_WIDTH              5   // Chars are 5 bits wide
 #define CHAR_HEIGHT             8   // Chars are 8 bits high
 
+#define LCD_ROWS                2   // Rows on the display
+#define LCD_COLUMNS             16  // Visible columns per row
+#define LCD_LINE_LENGTH         40  // DDRAM columns per row (0x00-0x27, 0x40-0x67)
+
 // Display commands
 #define LCD_CLEARDISPLAY        0x01
 #define LCD_RETURNHOME          0x02
@@ -51,35 +58,262 @@
 #define LCD_BACKLIGHT           0x08
 #define LCD_NOBACKLIGHT         0x00
 
+// I2C bus speeds
+#define LCD_I2C_PROBE           0           // Pick the fastest that works
+#define LCD_I2C_STANDARD        100000
+#define LCD_I2C_FAST            400000
+#define LCD_I2C_FAST_PLUS       1000000
+
+// Transfer modes
+#define LCD_TRANSFER_BLOCKING   0x00
+#define LCD_TRANSFER_DMA        0x01
+#define LCD_TRANSFER_QUEUED     0x02
+
+#define LCD_QUEUE_SIZE          512 // Queued mode entries, must be a power of 2
+
+// Timing modes
+#define LCD_TIMING_FIXED        0x00
+#define LCD_TIMING_BUSYFLAG     0x01
+
+// Glyph cache
+#define LCD_CGRAM_SLOTS         8       // Custom characters the controller holds
+#define LCD_MAX_GLYPHS          254     // Glyph IDs 0 - 253
+#define LCD_GLYPH_ESCAPE        0x1B    // In strings, the next byte is a glyph ID
+#define LCD_GLYPH_MISSING       0xFF    // Drawn when every slot is on screen (solid block)
+
+// Framebuffer and fields
+#define LCD_REFRESH_HZ          200     // Refresh timer rate, the fastest refresh
+
 // Writing bits
 #define ENABLE_BIT              0b00000100
 #define READ_WRITE_BIT          0b00000010
 #define REG_SELECT_BIT          0b00000001
 
+/********************************
+ * Field
+ *
+ * A fixed spot on screen showing a number. Allocated by
+ * the application, see LCD_fieldInit. The formatter fills
+ * exactly width chars.
+ ********************************/
+typedef void (*LCD_FieldFormatFxn)(int32_t value, uint8_t * text, uint8_t width);
+
+typedef struct LCD_Field
+{
+    struct LCD_Field * next;            // Next field on the same display
+    uint8_t row;
+    uint8_t col;
+    uint8_t width;
+    LCD_FieldFormatFxn formatFxn;
+    uint16_t interval;                  // Refresh ticks between renders
+    uint16_t countdown;                 // Ticks until it may render again
+    volatile int32_t value;             // Newest value, older ones are dropped
+    volatile bool dirty;                // Set since the last render
+} LCD_Field;
+
+/********************************
+ * Display object
+ *
+ * One per LCD, allocated by the application and passed
+ * to every call as an LCD_Handle. Treat the fields as
+ * private, they belong to i2c_lcd.c.
+ ********************************/
+#define LCD_TX_BUFFER_SIZE      256 // Expander bytes per burst
+
+struct LCD_Bus;
+
+/********************************
+ * Counters, see LCD_getStats()
+ ********************************/
+typedef struct LCD_Stats
+{
+    uint32_t transactions;              // I2C START conditions
+    uint32_t bytes;                     // Expander bytes sent
+    uint32_t nacks;                     // Transactions the expander didn't acknowledge
+    uint32_t delayUs;                   // CPU time spent waiting out settle delays
+    uint32_t commands;                  // Instructions sent to the LCD
+    uint32_t data;                      // Characters and CGRAM rows sent to the LCD
+} LCD_Stats;
+
+typedef struct LCD_Object
+{
+    struct LCD_Object * next;           // Next display on the same bus
+    struct LCD_Bus * bus;               // EUSCI_B module this display hangs off
+    uint8_t slaveAddress;
+
+    uint8_t displayControl;             // Handles display and cursor
+    uint8_t displayMode;                // Handles the direction of text
+    uint8_t backlightVal;               // Whether back light is on or off
+    uint8_t timingMode;                 // LCD_TIMING_FIXED or LCD_TIMING_BUSYFLAG
+
+    uint8_t ddram[LCD_ROWS][LCD_LINE_LENGTH];   // Shadow copy of DDRAM
+    volatile bool ddramValid;           // False after a NACK until the next clear
+    uint8_t address;                    // Logical address counter
+    uint8_t hwAddress;                  // Controller address counter
+    volatile bool hwAddressValid;       // False when the controller AC is unknown
+    uint8_t displayShift;               // Columns the display is shifted left, 0-39
+
+    const uint8_t (*glyphs)[CHAR_HEIGHT];       // Glyph table, normally in flash
+    uint8_t glyphCount;
+    uint8_t cgramGlyph[LCD_CGRAM_SLOTS];        // Shadow of CGRAM: glyph ID per slot
+    uint32_t cgramUsed[LCD_CGRAM_SLOTS];        // glyphClock at each slot's last use
+    uint32_t glyphClock;                        // Glyph lookups so far
+
+    const uint8_t * marqueeText[LCD_ROWS];      // Caller's text, NULL when not scrolling
+    uint16_t marqueeLength[LCD_ROWS];
+    uint32_t marqueeOrigin[LCD_ROWS];           // marqueeStep the text started at
+    uint32_t marqueeStep;                       // Steps taken, display shift follows it
+
+    uint8_t fb[LCD_ROWS][LCD_COLUMNS];          // Back buffer, the application draws here
+    uint8_t fbFront[LCD_ROWS][LCD_COLUMNS];     // Last committed frame, refresh reads it
+    volatile bool fbDirty;                      // Committed since the last refresh
+    uint16_t fbInterval;                        // Refresh timer ticks between refreshes
+    uint16_t fbCountdown;
+    bool fbRunning;
+
+    struct LCD_Field * fields;                  // Fields rendered by the refresh timer
+    struct LCD_Object * refreshNext;            // Next display the refresh timer serves
+    volatile uint8_t inCall;                    // Public calls under way, the refresh skips it
+
+    uint8_t txBuffers[2][LCD_TX_BUFFER_SIZE];
+    uint8_t * txBuffer;                 // Buffer being filled
+    uint16_t txLength;
+
+    uint16_t queue[LCD_QUEUE_SIZE];     // Queued mode entries
+    volatile uint16_t queueHead;        // Next free entry, only moved by producer
+    volatile uint16_t queueTail;        // Next entry to send, only moved by ISRs
+
+    volatile uint32_t lastEdge;         // TIMER32_0 tick of the last enable edge
+    volatile uint32_t readyAt;          // TIMER32_0 tick a queued delay ends
+    volatile bool waiting;              // Queued delay in progress
+    volatile bool busy;                 // Transfer or queued work pending
+
+    void (*transferDoneFxn)(struct LCD_Object * lcd);
+
+    LCD_Stats stats;
+} LCD_Object;
+
+typedef LCD_Object * LCD_Handle;
+
+/********************************
+ * Latency histograms, only with LCD_PROFILE defined
+ ********************************/
+#ifdef LCD_PROFILE
+#define LCD_PROFILE_BUCKETS     32  // log2 of DWT cycles
+
+enum
+{
+    LCD_PROFILE_INIT,
+    LCD_PROFILE_CLEAR,
+    LCD_PROFILE_HOME,
+    LCD_PROFILE_DISPLAY_ON,
+    LCD_PROFILE_DISPLAY_OFF,
+    LCD_PROFILE_SET_CURSOR_POSITION,
+    LCD_PROFILE_CURSOR_ON,
+    LCD_PROFILE_CURSOR_OFF,
+    LCD_PROFILE_BLINK_ON,
+    LCD_PROFILE_BLINK_OFF,
+    LCD_PROFILE_SHIFT_DISPLAY_LEFT,
+    LCD_PROFILE_SHIFT_DISPLAY_RIGHT,
+    LCD_PROFILE_TEXT_LEFT_TO_RIGHT,
+    LCD_PROFILE_TEXT_RIGHT_TO_LEFT,
+    LCD_PROFILE_AUTOSCROLL_ON,
+    LCD_PROFILE_AUTOSCROLL_OFF,
+    LCD_PROFILE_BACKLIGHT_ON,
+    LCD_PROFILE_BACKLIGHT_OFF,
+    LCD_PROFILE_CREATE_CHAR,
+    LCD_PROFILE_WRITE_GLYPH,
+    LCD_PROFILE_WRITE_CHAR,
+    LCD_PROFILE_WRITE_STRING,
+    LCD_PROFILE_WRITE_RAW,
+    LCD_PROFILE_WRITE_INT,
+    LCD_PROFILE_WRITE_FIXED,
+    LCD_PROFILE_WRITE_HEX,
+    LCD_PROFILE_PRINTF,
+    LCD_PROFILE_MARQUEE_START,
+    LCD_PROFILE_MARQUEE_STEP,
+    LCD_PROFILE_SET_TIMING_MODE,
+    LCD_PROFILE_SET_TRANSFER_MODE,
+    LCD_PROFILE_WAIT_IDLE,
+    LCD_PROFILE_CLOCK_CHANGED,
+    LCD_PROFILE_EXPANDER_WRITE,
+    LCD_PROFILE_COUNT
+};
+
+typedef struct LCD_Profile
+{
+    uint32_t count;                             // Calls recorded
+    uint32_t max;                               // Longest call in cycles
+    uint32_t buckets[LCD_PROFILE_BUCKETS];      // Calls taking < 2^bucket cycles
+} LCD_Profile;
+#endif
+
 /********************************
  * User Functions
  ********************************/
-int LCD_init(uint8_t slaveAddress);
-void LCD_clear(void);
-void LCD_home(void);
-void LCD_displayOn(void);
-void LCD_displayOff(void);
-int LCD_setCursorPosition(uint8_t row, uint8_t col);
-void LCD_cursorOn(void);
-void LCD_cursorOff(void);
-void LCD_blinkOn(void);
-void LCD_blinkOff(void);
-void LCD_shiftDisplayLeft(void);
-void LCD_shiftDisplayRight(void);
-void LCD_textLeftToRight(void);
-void LCD_textRightToLeft(void);
-void LCD_autoscrollOn(void);
-void LCD_autoscrollOff(void);
-void LCD_backlightOn(void);
-void LCD_backlightOff(void);
-int LCD_isBacklightOn(void);
-int LCD_createChar(uint8_t memAddress, uint8_t charMap[]);
-void LCD_writeChar(uint8_t value);
-void LCD_writeString(uint8_t * charBuffer, uint8_t numChars);
+int LCD_init(LCD_Handle lcd, uint32_t moduleInstance, uint8_t slaveAddress, uint32_t busSpeed);
+uint32_t LCD_getBusSpeed(LCD_Handle lcd);
+int LCD_clockChanged(void);
+uint32_t LCD_ticksToUs(uint32_t ticks);
+void LCD_clear(LCD_Handle lcd);
+void LCD_home(LCD_Handle lcd);
+void LCD_displayOn(LCD_Handle lcd);
+void LCD_displayOff(LCD_Handle lcd);
+int LCD_setCursorPosition(LCD_Handle lcd, uint8_t row, uint8_t col);
+void LCD_cursorOn(LCD_Handle lcd);
+void LCD_cursorOff(LCD_Handle lcd);
+void LCD_blinkOn(LCD_Handle lcd);
+void LCD_blinkOff(LCD_Handle lcd);
+void LCD_shiftDisplayLeft(LCD_Handle lcd);
+void LCD_shiftDisplayRight(LCD_Handle lcd);
+void LCD_textLeftToRight(LCD_Handle lcd);
+void LCD_textRightToLeft(LCD_Handle lcd);
+void LCD_autoscrollOn(LCD_Handle lcd);
+void LCD_autoscrollOff(LCD_Handle lcd);
+void LCD_backlightOn(LCD_Handle lcd);
+void LCD_backlightOff(LCD_Handle lcd);
+int LCD_isBacklightOn(LCD_Handle lcd);
+int LCD_createChar(LCD_Handle lcd, uint8_t memAddress, uint8_t charMap[]);
+int LCD_setGlyphTable(LCD_Handle lcd, const uint8_t (*glyphs)[CHAR_HEIGHT], uint8_t count);
+int LCD_writeGlyph(LCD_Handle lcd, uint8_t glyphId);
+void LCD_writeChar(LCD_Handle lcd, uint8_t value);
+void LCD_writeString(LCD_Handle lcd, uint8_t * charBuffer, uint8_t numChars);
+void LCD_writeRaw(LCD_Handle lcd, const uint8_t * charBuffer, uint8_t numChars);
+void LCD_writeInt(LCD_Handle lcd, int32_t value, uint8_t width);
+void LCD_writeFixed(LCD_Handle lcd, int32_t value, uint8_t decimals, uint8_t width);
+void LCD_writeHex(LCD_Handle lcd, uint32_t value, uint8_t width);
+int LCD_printf(LCD_Handle lcd, const char * format, ...);
+int LCD_marqueeStart(LCD_Handle lcd, uint8_t row, const uint8_t * text, uint16_t length);
+void LCD_marqueeStop(LCD_Handle lcd, uint8_t row);
+void LCD_marqueeStep(LCD_Handle lcd);
+int LCD_fbStart(LCD_Handle lcd, uint16_t refreshHz);
+void LCD_fbStop(LCD_Handle lcd);
+uint8_t (*LCD_framebuffer(LCD_Handle lcd))[LCD_COLUMNS];
+void LCD_commit(LCD_Handle lcd);
+int LCD_fieldInit(LCD_Handle lcd, LCD_Field * field, uint8_t row, uint8_t col, uint8_t width,
+                  LCD_FieldFormatFxn formatFxn, uint16_t rateHz);
+void LCD_fieldRemove(LCD_Handle lcd, LCD_Field * field);
+void LCD_fieldSet(LCD_Field * field, int32_t value);
+void LCD_fieldDecimal(int32_t value, uint8_t * text, uint8_t width);
+void LCD_setTransferMode(LCD_Handle lcd, uint8_t mode);
+int LCD_isBusy(LCD_Handle lcd);
+void LCD_waitIdle(LCD_Handle lcd);
+uint16_t LCD_queueLevel(LCD_Handle lcd);
+int LCD_setTimingMode(LCD_Handle lcd, uint8_t mode);
+void LCD_setTransferDoneFxn(LCD_Handle lcd, void (*doneFxn)(LCD_Handle lcd));
+void LCD_getStats(LCD_Handle lcd, LCD_Stats * stats);
+void LCD_resetStats(LCD_Handle lcd);
+#ifdef LCD_PROFILE
+const LCD_Profile * LCD_getProfile(uint8_t id);
+const char * LCD_profileName(uint8_t id);
+uint32_t LCD_profilePercentile(const LCD_Profile * profile, uint8_t percent);
+void LCD_resetProfile(void);
+#endif
+void LCD_dmaB0IntHandler(void);
+void LCD_dmaB1IntHandler(void);
+void LCD_i2cB0IntHandler(void);
+void LCD_i2cB1IntHandler(void);
+void LCD_timerIntHandler(void);
+void LCD_refreshIntHandler(void);
 
 #endif /* I2C_LCD_H_ */
@@ -0,0 +1,609 @@
+/*
+ * bench.c
+ *
+ *  Runs every public LCD_* call through a realistic workload at
+ *  100kHz and 400kHz and reports over the USB UART, per call:
+ *
+ *    cpu: time until the call returned (DMA mode, bus runs on)
+ *    bus: time until everything it sent reached the LCD
+ *    bytes: expander bytes it put on the bus, to 1/100
+ *
+ *  The number formatters are also timed in CPU cycles against
+ *  sprintf into a buffer plus LCD_writeString.
+ *
+ *  Each result is checked against a budget, a recorded
+ *  baseline plus a margin, and the run ends
+ *  with "BENCH PASS" or "BENCH FAIL <count>" so a script on
+ *  the serial port can catch regressions.
+ *
+ *  host/bench_main.c runs the same cases against the LCD
+ *  model (make -C host bench). Times there are pure bus
+ *  time and the cycle comparison is skipped.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <driverlib.h>
+#include "bench.h"
+#include "usb.h"
+
+/***************************
+ * File Specific Defines
+ ***************************/
+#define BENCH_PASSES        8       // Runs of each case, averaged
+#define BENCH_SPEEDS        2       // 100kHz and 400kHz
+#define BENCH_GLYPHS        12      // More than the 8 CGRAM slots on purpose
+
+#define BUDGET_MARGIN       10      // Percent over the baseline
+#define BUDGET_SLACK_US     100     // DMA setup and interrupt latency
+
+typedef struct BENCH_Case
+{
+    const char * name;
+    void (*op)(LCD_Handle lcd, uint16_t pass);
+    void (*setup)(LCD_Handle lcd, uint16_t pass);   // Untimed, before each pass, or NULL
+    uint32_t baselineUs[BENCH_SPEEDS];              // Recorded bus time per call
+} BENCH_Case;
+
+typedef struct BENCH_Format
+{
+    const char * name;
+    void (*op)(LCD_Handle lcd, uint16_t pass);
+    void (*reference)(LCD_Handle lcd, uint16_t pass);   // Same output with sprintf
+} BENCH_Format;
+
+/***************************
+ * File Specific Functions
+ ***************************/
+static void _fullRedraw(LCD_Handle lcd, uint16_t pass);
+static void _fieldUpdate(LCD_Handle lcd, uint16_t pass);
+static void _writeChar(LCD_Handle lcd, uint16_t pass);
+static void _glyphChurn(LCD_Handle lcd, uint16_t pass);
+static void _scroll(LCD_Handle lcd, uint16_t pass);
+static void _clear(LCD_Handle lcd, uint16_t pass);
+static void _home(LCD_Handle lcd, uint16_t pass);
+static void _statusLine(LCD_Handle lcd, uint16_t pass);
+static void _shifted(LCD_Handle lcd, uint16_t pass);
+static void _display(LCD_Handle lcd, uint16_t pass);
+static void _cursor(LCD_Handle lcd, uint16_t pass);
+static void _blink(LCD_Handle lcd, uint16_t pass);
+static void _textDirection(LCD_Handle lcd, uint16_t pass);
+static void _autoscroll(LCD_Handle lcd, uint16_t pass);
+static void _backlight(LCD_Handle lcd, uint16_t pass);
+static void _createChar(LCD_Handle lcd, uint16_t pass);
+static void _writeInt(LCD_Handle lcd, uint16_t pass);
+static void _sprintfInt(LCD_Handle lcd, uint16_t pass);
+static void _writeFixed(LCD_Handle lcd, uint16_t pass);
+static void _sprintfFixed(LCD_Handle lcd, uint16_t pass);
+static void _writeHex(LCD_Handle lcd, uint16_t pass);
+static void _sprintfHex(LCD_Handle lcd, uint16_t pass);
+static void _printf(LCD_Handle lcd, uint16_t pass);
+static void _sprintf(LCD_Handle lcd, uint16_t pass);
+static int _formatCycles(LCD_Handle lcd);
+#ifndef DRIVERLIB_STUB
+static uint32_t _cycles(LCD_Handle lcd, void (*op)(LCD_Handle lcd, uint16_t pass));
+#endif
+static uint32_t _budgetUs(uint32_t baselineUs);
+static int _check(const char * name, uint32_t speed, uint32_t bytes100, uint32_t cpuUs,
+                  uint32_t busUs, uint32_t maxUs, uint32_t budgetUs);
+static void _sendHundredths(uint32_t value);
+static uint32_t _now(void);
+static uint32_t _elapsedUs(uint32_t start);
+
+/***************************
+ * Global Variables
+ ***************************/
+static const uint32_t _speeds[BENCH_SPEEDS] = { LCD_I2C_STANDARD, LCD_I2C_FAST };
+
+// Baselines are the average bus time per call at 100kHz and
+// 400kHz recorded with make -C host bench, see _budgetUs.
+// Re-record them when a change makes a call cheaper, so the
+// budget follows. Clear and home start from a written status
+// line and a shifted display, otherwise there'd be nothing
+// for the planner to do.
+static const BENCH_Case _cases[] =
+{
+    { "writeString32",  _fullRedraw,    NULL,           { 18720, 4681 } },
+    { "fieldUpdate",    _fieldUpdate,   NULL,           {  2381,  596 } },
+    { "writeChar",      _writeChar,     NULL,           {   651,  163 } },
+    { "glyphChurn",     _glyphChurn,    NULL,           {  6701, 1676 } },
+    { "shiftLeft",      _scroll,        NULL,           {   651,  163 } },
+    { "clear",          _clear,         _statusLine,    {  5151, 2615 } },
+    { "home",           _home,          _shifted,       {  1191,  298 } },
+    { "displayOnOff",   _display,       NULL,           {   651,  163 } },
+    { "cursorOnOff",    _cursor,        NULL,           {   651,  163 } },
+    { "blinkOnOff",     _blink,         NULL,           {   651,  163 } },
+    { "textDirection",  _textDirection, NULL,           {   651,  163 } },
+    { "autoscroll",     _autoscroll,    NULL,           {   651,  163 } },
+    { "backlight",      _backlight,     NULL,           {   201,   51 } },
+    { "createChar",     _createChar,    NULL,           {  5511, 1378 } }
+};
+
+static const uint32_t _initBaselineUs[BENCH_SPEEDS] = { 63795, 60315 };
+
+static const BENCH_Format _formats[] =
+{
+    { "writeInt",       _writeInt,      _sprintfInt },
+    { "writeFixed",     _writeFixed,    _sprintfFixed },
+    { "writeHex",       _writeHex,      _sprintfHex },
+    { "printf",         _printf,        _sprintf }
+};
+
+// Bar graph pieces: 8 heights then 4 widths
+static const uint8_t _glyphs[BENCH_GLYPHS][CHAR_HEIGHT] =
+{
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F },
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F },
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F },
+    { 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F },
+    { 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F },
+    { 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F },
+    { 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F },
+    { 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F },
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 },
+    { 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18 },
+    { 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C },
+    { 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E }
+};
+
+/***************************
+ * Run every case at every speed
+ * The LCD is left initialized in blocking mode
+ * at the last speed, re-init it afterwards
+ *
+ * Returns: number of results over budget
+ ***************************/
+int BENCH_run(LCD_Handle lcd, uint32_t moduleInstance, uint8_t slaveAddress)
+{
+    int failures = 0;
+    uint8_t speed;
+
+    // LCD_init starts the TIMER32_0 we time with
+    LCD_init(lcd, moduleInstance, slaveAddress, _speeds[0]);
+
+    for(speed = 0; speed < BENCH_SPEEDS; speed++)
+    {
+        uint32_t start = _now();
+        if(!LCD_init(lcd, moduleInstance, slaveAddress, _speeds[speed]))
+        {
+            USB_sendString("BENCH no LCD\r\n");
+            return 1;
+        }
+        uint32_t initUs = _elapsedUs(start);
+
+        LCD_Stats stats;
+        LCD_getStats(lcd, &stats);
+        failures += _check("init", _speeds[speed], stats.bytes * 100, initUs, initUs, initUs,
+                           _budgetUs(_initBaselineUs[speed]));
+
+        LCD_setGlyphTable(lcd, _glyphs, BENCH_GLYPHS);
+        LCD_setTransferMode(lcd, LCD_TRANSFER_DMA);
+
+        uint8_t i;
+        for(i = 0; i < sizeof(_cases) / sizeof(_cases[0]); i++)
+        {
+            uint32_t cpuUs = 0;
+            uint32_t busUs = 0;
+            uint32_t maxUs = 0;
+            uint32_t bytes = 0;
+
+            uint16_t pass;
+            for(pass = 0; pass < BENCH_PASSES; pass++)
+            {
+                if(_cases[i].setup)
+                {
+                    _cases[i].setup(lcd, pass);
+                    LCD_waitIdle(lcd);
+                }
+                LCD_resetStats(lcd);
+
+                start = _now();
+                _cases[i].op(lcd, pass);
+                uint32_t returned = _elapsedUs(start);
+                LCD_waitIdle(lcd);
+                uint32_t done = _elapsedUs(start);
+
+                LCD_getStats(lcd, &stats);
+                bytes += stats.bytes;
+                cpuUs += returned;
+                busUs += done;
+                if(done > maxUs)
+                {
+                    maxUs = done;
+                }
+            }
+
+            failures += _check(_cases[i].name, _speeds[speed], bytes * 100 / BENCH_PASSES,
+                               cpuUs / BENCH_PASSES, busUs / BENCH_PASSES, maxUs,
+                               _budgetUs(_cases[i].baselineUs[speed]));
+        }
+
+        // Formatting costs the same at any bus speed
+        if(speed == 0)
+        {
+            failures += _formatCycles(lcd);
+        }
+
+        LCD_setTransferMode(lcd, LCD_TRANSFER_BLOCKING);
+    }
+
+    if(failures)
+    {
+        USB_sendString("BENCH FAIL ");
+        USB_sendNumber(failures);
+    }
+    else
+    {
+        USB_sendString("BENCH PASS");
+    }
+    USB_sendString("\r\n");
+
+    return failures;
+}
+
+/***************************
+ * A full screen of text, every cell changes each pass
+ ***************************/
+static void _fullRedraw(LCD_Handle lcd, uint16_t pass)
+{
+    uint8_t text[LCD_COLUMNS];
+    uint8_t row;
+    for(row = 0; row < LCD_ROWS; row++)
+    {
+        uint8_t col;
+        for(col = 0; col < LCD_COLUMNS; col++)
+        {
+            text[col] = '0' + (col + row + pass) % 10;
+        }
+
+        LCD_setCursorPosition(lcd, row, 0);
+        LCD_writeString(lcd, text, LCD_COLUMNS);
+    }
+}
+
+/***************************
+ * A 3 digit reading in the corner, like a sensor value
+ ***************************/
+static void _fieldUpdate(LCD_Handle lcd, uint16_t pass)
+{
+    uint16_t value = (pass * 37) % 1000;
+    uint8_t text[3] = { '0' + value / 100, '0' + (value / 10) % 10, '0' + value % 10 };
+
+    LCD_setCursorPosition(lcd, 1, 13);
+    LCD_writeString(lcd, text, 3);
+}
+
+/***************************/
+static void _writeChar(LCD_Handle lcd, uint16_t pass)
+{
+    LCD_writeChar(lcd, 'A' + pass % 26);
+}
+
+/***************************
+ * One cell cycling through more glyphs than CGRAM holds
+ ***************************/
+static void _glyphChurn(LCD_Handle lcd, uint16_t pass)
+{
+    LCD_setCursorPosition(lcd, 0, 15);
+    LCD_writeGlyph(lcd, (pass * 5) % BENCH_GLYPHS);
+}
+
+/***************************/
+static void _scroll(LCD_Handle lcd, uint16_t pass)
+{
+    (void)pass;
+    LCD_shiftDisplayLeft(lcd);
+}
+
+/***************************/
+static void _clear(LCD_Handle lcd, uint16_t pass)
+{
+    (void)pass;
+    LCD_clear(lcd);
+}
+
+/***************************/
+static void _home(LCD_Handle lcd, uint16_t pass)
+{
+    (void)pass;
+    LCD_home(lcd);
+}
+
+/***************************
+ * Setup for clear, a status line that changes each pass
+ ***************************/
+static void _statusLine(LCD_Handle lcd, uint16_t pass)
+{
+    LCD_setCursorPosition(lcd, 0, 0);
+    LCD_printf(lcd, "Temp %3u RPM%4u", 20 + pass % 8, pass * 123u);
+}
+
+/***************************
+ * Setup for home, the cursor away from 0 and the
+ * display shifted so home has to undo both
+ ***************************/
+static void _shifted(LCD_Handle lcd, uint16_t pass)
+{
+    LCD_setCursorPosition(lcd, 1, 5 + pass % 8);
+    LCD_writeChar(lcd, '*');
+    LCD_shiftDisplayLeft(lcd);
+}
+
+/***************************/
+static void _display(LCD_Handle lcd, uint16_t pass)
+{
+    if(pass & 1)
+    {
+        LCD_displayOn(lcd);
+    }
+    else
+    {
+        LCD_displayOff(lcd);
+    }
+}
+
+/***************************/
+static void _cursor(LCD_Handle lcd, uint16_t pass)
+{
+    if(pass & 1)
+    {
+        LCD_cursorOn(lcd);
+    }
+    else
+    {
+        LCD_cursorOff(lcd);
+    }
+}
+
+/***************************/
+static void _blink(LCD_Handle lcd, uint16_t pass)
+{
+    if(pass & 1)
+    {
+        LCD_blinkOn(lcd);
+    }
+    else
+    {
+        LCD_blinkOff(lcd);
+    }
+}
+
+/***************************/
+static void _textDirection(LCD_Handle lcd, uint16_t pass)
+{
+    if(pass & 1)
+    {
+        LCD_textLeftToRight(lcd);
+    }
+    else
+    {
+        LCD_textRightToLeft(lcd);
+    }
+}
+
+/***************************/
+static void _autoscroll(LCD_Handle lcd, uint16_t pass)
+{
+    if(pass & 1)
+    {
+        LCD_autoscrollOff(lcd);
+    }
+    else
+    {
+        LCD_autoscrollOn(lcd);
+    }
+}
+
+/***************************/
+static void _backlight(LCD_Handle lcd, uint16_t pass)
+{
+    if(pass & 1)
+    {
+        LCD_backlightOn(lcd);
+    }
+    else
+    {
+        LCD_backlightOff(lcd);
+    }
+}
+
+/***************************
+ * Runs last, it pins slot 7 away from the glyph cache
+ ***************************/
+static void _createChar(LCD_Handle lcd, uint16_t pass)
+{
+    uint8_t charMap[CHAR_HEIGHT];
+    memcpy(charMap, _glyphs[pass % BENCH_GLYPHS], CHAR_HEIGHT);
+
+    LCD_createChar(lcd, 7, charMap);
+}
+
+/***************************
+ * Number formatters and their sprintf equivalents,
+ * values change every pass so cells really get written
+ ***************************/
+static void _writeInt(LCD_Handle lcd, uint16_t pass)
+{
+    LCD_setCursorPosition(lcd, 1, 0);
+    LCD_writeInt(lcd, pass * 1237L - 4000, 6);
+}
+
+static void _sprintfInt(LCD_Handle lcd, uint16_t pass)
+{
+    char text[12];
+    int length = sprintf(text, "%6ld", pass * 1237L - 4000);
+
+    LCD_setCursorPosition(lcd, 1, 0);
+    LCD_writeString(lcd, (uint8_t *)text, length);
+}
+
+static void _writeFixed(LCD_Handle lcd, uint16_t pass)
+{
+    LCD_setCursorPosition(lcd, 1, 0);
+    LCD_writeFixed(lcd, pass * 1237L, 2, 7);
+}
+
+static void _sprintfFixed(LCD_Handle lcd, uint16_t pass)
+{
+    char text[12];
+    long value = pass * 1237L;
+    int length = sprintf(text, "%4ld.%02ld", value / 100, value % 100);
+
+    LCD_setCursorPosition(lcd, 1, 0);
+    LCD_writeString(lcd, (uint8_t *)text, length);
+}
+
+static void _writeHex(LCD_Handle lcd, uint16_t pass)
+{
+    LCD_setCursorPosition(lcd, 1, 0);
+    LCD_writeHex(lcd, (pass * 0x1357UL) & 0xFFFF, 4);
+}
+
+static void _sprintfHex(LCD_Handle lcd, uint16_t pass)
+{
+    char text[12];
+    int length = sprintf(text, "%04lX", (pass * 0x1357UL) & 0xFFFF);
+
+    LCD_setCursorPosition(lcd, 1, 0);
+    LCD_writeString(lcd, (uint8_t *)text, length);
+}
+
+static void _printf(LCD_Handle lcd, uint16_t pass)
+{
+    LCD_setCursorPosition(lcd, 0, 0);
+    LCD_printf(lcd, "T%4d RPM%5u", pass * 7 - 20, pass * 1237u);
+}
+
+static void _sprintf(LCD_Handle lcd, uint16_t pass)
+{
+    char text[32];
+    int length = sprintf(text, "T%4d RPM%5u", pass * 7 - 20, pass * 1237u);
+
+    LCD_setCursorPosition(lcd, 0, 0);
+    LCD_writeString(lcd, (uint8_t *)text, length);
+}
+
+/***************************
+ * Print CPU cycles per call for each formatter and
+ * its sprintf equivalent, e.g.
+ * "writeFixed cycles 812 sprintf 4133 PASS"
+ *
+ * Returns: number of formatters not faster than sprintf
+ ***************************/
+static int _formatCycles(LCD_Handle lcd)
+{
+    int failures = 0;
+
+    uint8_t i;
+    for(i = 0; i < sizeof(_formats) / sizeof(_formats[0]); i++)
+    {
+#ifdef DRIVERLIB_STUB
+        // The host stub's clock only moves with the bus, there are no
+        // cycles to compare, just run both against the model
+        _formats[i].op(lcd, 0);
+        _formats[i].reference(lcd, 0);
+        LCD_waitIdle(lcd);
+#else
+        uint32_t cycles = _cycles(lcd, _formats[i].op);
+        uint32_t reference = _cycles(lcd, _formats[i].reference);
+        bool slower = cycles >= reference;
+
+        USB_sendString(_formats[i].name);
+        USB_sendString(" cycles ");
+        USB_sendNumber(cycles);
+        USB_sendString(" sprintf ");
+        USB_sendNumber(reference);
+        USB_sendString(slower ? " FAIL\r\n" : " PASS\r\n");
+
+        failures += slower ? 1 : 0;
+#endif
+    }
+
+    return failures;
+}
+
+#ifndef DRIVERLIB_STUB
+/***************************
+ * Average cycles until op returns, the bus is left
+ * to finish between passes. TIMER32_0 counts MCLK.
+ ***************************/
+static uint32_t _cycles(LCD_Handle lcd, void (*op)(LCD_Handle lcd, uint16_t pass))
+{
+    uint32_t total = 0;
+
+    uint16_t pass;
+    for(pass = 0; pass < BENCH_PASSES; pass++)
+    {
+        uint32_t start = _now();
+        op(lcd, pass);
+        total += _now() - start;
+        LCD_waitIdle(lcd);
+    }
+
+    return total / BENCH_PASSES;
+}
+#endif
+
+/***************************
+ * A recorded baseline plus the margin. The slack covers
+ * DMA setup and interrupt latency the host model doesn't
+ * have, so hardware runs can use the same baselines.
+ ***************************/
+static uint32_t _budgetUs(uint32_t baselineUs)
+{
+    return baselineUs * (100 + BUDGET_MARGIN) / 100 + BUDGET_SLACK_US;
+}
+
+/***************************
+ * Print one result line, e.g.
+ * "clear 100000Hz bytes 7.50 cpu 5012us bus 5040us max 5051us PASS"
+ * Param: bytes100, expander bytes per call times 100
+ *
+ * Returns: 1 if over budget, 0 otherwise
+ ***************************/
+static int _check(const char * name, uint32_t speed, uint32_t bytes100, uint32_t cpuUs,
+                  uint32_t busUs, uint32_t maxUs, uint32_t budgetUs)
+{
+    bool over = busUs > budgetUs;
+
+    USB_sendString(name);
+    USB_sendString(" ");
+    USB_sendNumber(speed);
+    USB_sendString("Hz bytes ");
+    _sendHundredths(bytes100);
+    USB_sendString(" cpu ");
+    USB_sendNumber(cpuUs);
+    USB_sendString("us bus ");
+    USB_sendNumber(busUs);
+    USB_sendString("us max ");
+    USB_sendNumber(maxUs);
+    USB_sendString(over ? "us FAIL\r\n" : "us PASS\r\n");
+
+    return over ? 1 : 0;
+}
+
+/***************************
+ * value / 100 with two decimals, e.g. 750 is "7.50"
+ ***************************/
+static void _sendHundredths(uint32_t value)
+{
+    char text[4] = { '.', '0' + (value / 10) % 10, '0' + value % 10, '\0' };
+
+    USB_sendNumber(value / 100);
+    USB_sendString(text);
+}
+
+/***************************
+ * TIMER32_0 free runs down from LCD_init on
+ ***************************/
+static uint32_t _now(void)
+{
+    return ~Timer32_getValue(TIMER32_BASE);
+}
+
+static uint32_t _elapsedUs(uint32_t start)
+{
+    return LCD_ticksToUs(_now() - start);
+}
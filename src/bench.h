@@ -0,0 +1,15 @@
+/*
+ * bench.h
+ *
+ *  Throughput and latency benchmarks for the i2c_lcd API
+ *  Built into the example when LCD_BENCHMARK is defined
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include "i2c_lcd.h"
+
+int BENCH_run(LCD_Handle lcd, uint32_t moduleInstance, uint8_t slaveAddress);
+
+#endif /* BENCH_H_ */
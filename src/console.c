@@ -0,0 +1,167 @@
+/*
+ * console.c
+ *
+ *  Command table for the text console, see console.h
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "console.h"
+
+/***************************
+ * File Specific Defines
+ ***************************/
+#define FNV_PRIME               16777619u
+#define SLOT_EMPTY              0xFF
+
+/***************************
+ * File Specific Functions
+ ***************************/
+static uint32_t _hash(const char * name, uint8_t length);
+static uint8_t _tokenize(char * line, char * argv[]);
+
+/***************************
+ * Global Variables
+ ***************************/
+static const CONSOLE_Command * _commands;
+static uint32_t _seed;
+static uint8_t _slots[CONSOLE_SLOTS];           // Index into _commands
+
+/***************************
+ * Build the hash table for a list of commands,
+ * the list is used in place and must stay around
+ * Returns: 1 if successful, 0 if two names share a
+ *          slot (pick another seed) or there are too many
+ ***************************/
+int CONSOLE_init(const CONSOLE_Command * commands, uint8_t count, uint32_t seed)
+{
+    _commands = NULL;
+    _seed = seed;
+    memset(_slots, SLOT_EMPTY, sizeof(_slots));
+
+    if(count > CONSOLE_SLOTS)
+    {
+        return 0;
+    }
+
+    uint8_t i;
+    for(i = 0; i < count; i++)
+    {
+        uint32_t slot = _hash(commands[i].name, strlen(commands[i].name));
+        if(_slots[slot] != SLOT_EMPTY)
+        {
+            memset(_slots, SLOT_EMPTY, sizeof(_slots));
+            return 0;
+        }
+        _slots[slot] = i;
+    }
+
+    _commands = commands;
+    return 1;
+}
+
+/***************************
+ * Run the command a line starts with
+ * Arguments are split in place, nothing is copied.
+ * A line that isn't a command is left as it was,
+ * so is every line if CONSOLE_init didn't succeed.
+ * Returns: CONSOLE_NOT_FOUND, CONSOLE_OK or CONSOLE_BAD_ARGS
+ ***************************/
+int CONSOLE_dispatch(char * line)
+{
+    if(!_commands)
+    {
+        return CONSOLE_NOT_FOUND;
+    }
+
+    uint8_t length = strcspn(line, " ");
+    uint8_t index = _slots[_hash(line, length)];
+
+    if(index == SLOT_EMPTY)
+    {
+        return CONSOLE_NOT_FOUND;
+    }
+
+    const CONSOLE_Command * command = &_commands[index];
+    if(strncmp(line, command->name, length) != 0 || command->name[length] != 0)
+    {
+        return CONSOLE_NOT_FOUND;
+    }
+
+    char * argv[CONSOLE_MAX_ARGS];
+    uint8_t argc = _tokenize(line, argv);
+
+    if(argc == 0 || argc - 1 < command->minArgs || argc - 1 > command->maxArgs)
+    {
+        return CONSOLE_BAD_ARGS;
+    }
+
+    return command->fxn(argc, argv) ? CONSOLE_OK : CONSOLE_BAD_ARGS;
+}
+
+/***************************
+ * Read a whole argument as a number no bigger than max
+ * Returns: true if successful
+ ***************************/
+bool CONSOLE_parseNumber(const char * arg, uint8_t base, uint8_t max, uint8_t * value)
+{
+    char * end;
+    unsigned long number = strtoul(arg, &end, base);
+
+    if(end == arg || *end != 0 || number > max)
+    {
+        return false;
+    }
+
+    *value = (uint8_t)number;
+    return true;
+}
+
+/***************************
+ * FNV-1a from the seed, top bits pick the slot
+ ***************************/
+static uint32_t _hash(const char * name, uint8_t length)
+{
+    uint32_t hash = _seed;
+
+    while(length--)
+    {
+        hash ^= (uint8_t)*name++;
+        hash *= FNV_PRIME;
+    }
+
+    return hash >> (32 - CONSOLE_HASH_BITS);
+}
+
+/***************************
+ * Split on spaces by writing terminators into the line
+ * Returns: number of tokens, 0 if there were too many
+ ***************************/
+static uint8_t _tokenize(char * line, char * argv[])
+{
+    uint8_t argc = 0;
+
+    while(*line)
+    {
+        if(*line == ' ')
+        {
+            *line++ = 0;
+            continue;
+        }
+
+        if(argc == CONSOLE_MAX_ARGS)
+        {
+            return 0;
+        }
+        argv[argc++] = line;
+
+        while(*line && *line != ' ')
+        {
+            line++;
+        }
+    }
+
+    return argc;
+}
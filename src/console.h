@@ -0,0 +1,45 @@
+/*
+ * console.h
+ *
+ *  Command table for the text console
+ *
+ *  Commands are found with a perfect hash over their names:
+ *  one hash and one compare per line, however many commands
+ *  are registered. The seed is picked offline so that no two
+ *  names share a slot, CONSOLE_init fails if they do.
+ */
+
+#ifndef CONSOLE_H_
+#define CONSOLE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CONSOLE_HASH_BITS       5
+#define CONSOLE_SLOTS           (1 << CONSOLE_HASH_BITS)
+#define CONSOLE_MAX_ARGS        12      // Including the command name
+
+// CONSOLE_dispatch results
+#define CONSOLE_NOT_FOUND       0       // Not a command, line untouched
+#define CONSOLE_OK              1
+#define CONSOLE_BAD_ARGS        2
+
+/*
+ * argv[0] is the command name, the rest point into the line
+ * Returns: 1 if successful, 0 if the arguments were bad
+ */
+typedef int (*CONSOLE_CommandFxn)(uint8_t argc, char * argv[]);
+
+typedef struct
+{
+    const char * name;
+    uint8_t minArgs;                    // Not counting the name
+    uint8_t maxArgs;
+    CONSOLE_CommandFxn fxn;
+} CONSOLE_Command;
+
+int CONSOLE_init(const CONSOLE_Command * commands, uint8_t count, uint32_t seed);
+int CONSOLE_dispatch(char * line);
+bool CONSOLE_parseNumber(const char * arg, uint8_t base, uint8_t max, uint8_t * value);
+
+#endif /* CONSOLE_H_ */
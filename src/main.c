@@ -15,22 +15,116 @@
 #include "driverlib.h"
 #include "i2c_lcd.h"
 #include "usb.h"
+#include "protocol.h"
+#include "console.h"
+#ifdef LCD_BENCHMARK
+#include "bench.h"
+#endif
 
 /********************************
  * File Specific Defines
  ********************************/
 #define SLAVE_ADDRESS   0x27
-#define HAPPYFACE_ADDR  1
-#define HEART_ADDR      2
-#define DUCK_ADDR       3
+#define USB_BAUD_RATE   115200
+#define HAPPYFACE_GLYPH 0
+#define HEART_GLYPH     1
+#define DUCK_GLYPH      2
+#define GLYPH_COUNT     3
 #define ENTER_KEY       13
 #define BACK_KEY        8
+#define LINE_LENGTH     48
+#define MARQUEE_RATE    4       // Steps per second
+
+// Found offline so no two command names share a hash slot
+#define COMMAND_SEED    0x001A4B32
 
 /********************************
  * File Specific Functions
  ********************************/
-void createCustomChars(void);
-void usbCallbackFxn(uint8_t charReceived);
+void processChar(uint8_t charReceived);
+void processLine(char * line, uint8_t length);
+int commandHappy(uint8_t argc, char * argv[]);
+int commandHeart(uint8_t argc, char * argv[]);
+int commandDuck(uint8_t argc, char * argv[]);
+int commandHome(uint8_t argc, char * argv[]);
+int commandClear(uint8_t argc, char * argv[]);
+int commandDisplayOn(uint8_t argc, char * argv[]);
+int commandDisplayOff(uint8_t argc, char * argv[]);
+int commandCursorOn(uint8_t argc, char * argv[]);
+int commandCursorOff(uint8_t argc, char * argv[]);
+int commandBlinkOn(uint8_t argc, char * argv[]);
+int commandBlinkOff(uint8_t argc, char * argv[]);
+int commandShiftLeft(uint8_t argc, char * argv[]);
+int commandShiftRight(uint8_t argc, char * argv[]);
+int commandTextToRight(uint8_t argc, char * argv[]);
+int commandTextToLeft(uint8_t argc, char * argv[]);
+int commandAutoscrollOn(uint8_t argc, char * argv[]);
+int commandAutoscrollOff(uint8_t argc, char * argv[]);
+int commandBacklightOn(uint8_t argc, char * argv[]);
+int commandBacklightOff(uint8_t argc, char * argv[]);
+int commandSetPos(uint8_t argc, char * argv[]);
+int commandGlyph(uint8_t argc, char * argv[]);
+int commandMarquee(uint8_t argc, char * argv[]);
+int commandMarqueeOff(uint8_t argc, char * argv[]);
+int commandStats(uint8_t argc, char * argv[]);
+#ifdef LCD_PROFILE
+int commandProfile(uint8_t argc, char * argv[]);
+#endif
+void printStats(void);
+#ifdef LCD_PROFILE
+void printProfile(void);
+#endif
+void tickIntHandler(void);
+
+/********************************
+ * Global Variables
+ ********************************/
+static LCD_Object lcdObject;
+static LCD_Handle lcd = &lcdObject;
+
+// Marquee text has to outlive the line it came in on
+static uint8_t marqueeText[LINE_LENGTH];
+static volatile bool marqueeTick;
+
+// Custom chars stay in flash, the driver loads them into CGRAM as needed
+static const uint8_t glyphs[GLYPH_COUNT][CHAR_HEIGHT] =
+{
+    { 0x00, 0x00, 0x0A, 0x00, 0x11, 0x0E, 0x00 },   // Happy face
+    { 0x00, 0x0A, 0x1F, 0x1F, 0x0E, 0x04, 0x00 },   // Heart
+    { 0x00, 0x0C, 0x1D, 0x0F, 0x0F, 0x06, 0x00 }    // Duck
+};
+
+// Console commands, name then min and max arguments
+static const CONSOLE_Command commands[] =
+{
+    { "HAPPY",          0, 0,               commandHappy },
+    { "HEART",          0, 0,               commandHeart },
+    { "DUCK",           0, 0,               commandDuck },
+    { "HOME",           0, 0,               commandHome },
+    { "CLEAR",          0, 0,               commandClear },
+    { "DISPLAYON",      0, 0,               commandDisplayOn },
+    { "DISPLAYOFF",     0, 0,               commandDisplayOff },
+    { "CURSORON",       0, 0,               commandCursorOn },
+    { "CURSOROFF",      0, 0,               commandCursorOff },
+    { "BLINKON",        0, 0,               commandBlinkOn },
+    { "BLINKOFF",       0, 0,               commandBlinkOff },
+    { "SHIFTLEFT",      0, 0,               commandShiftLeft },
+    { "SHIFTRIGHT",     0, 0,               commandShiftRight },
+    { "TEXTTORIGHT",    0, 0,               commandTextToRight },
+    { "TEXTTOLEFT",     0, 0,               commandTextToLeft },
+    { "AUTOSCROLLON",   0, 0,               commandAutoscrollOn },
+    { "AUTOSCROLLOFF",  0, 0,               commandAutoscrollOff },
+    { "BACKLIGHTON",    0, 0,               commandBacklightOn },
+    { "BACKLIGHTOFF",   0, 0,               commandBacklightOff },
+    { "SETPOS",         2, 2,               commandSetPos },
+    { "GLYPH",          1, 1 + CHAR_HEIGHT, commandGlyph },
+    { "MARQUEE",        1, CONSOLE_MAX_ARGS - 1, commandMarquee },
+    { "MARQUEEOFF",     0, 0,               commandMarqueeOff },
+    { "STATS",          0, 0,               commandStats },
+#ifdef LCD_PROFILE
+    { "PROFILE",        0, 0,               commandProfile },
+#endif
+};
 
 /********************************/
 int main(void)
@@ -38,49 +132,72 @@ int main(void)
     // Disable Watchdog
     WDT_A_holdTimer();
 
-    // Initialize USB at 9600 baud
-    USB_init(&usbCallbackFxn);
+    // Initialize USB
+    USB_init(USB_BAUD_RATE);
 
-    // Initialize LCD with slave address
-    LCD_init(SLAVE_ADDRESS);
+#ifdef LCD_BENCHMARK
+    // Numbers for every LCD call go out over USB first
+    BENCH_run(lcd, EUSCI_B0_BASE, SLAVE_ADDRESS);
+#endif
 
-    // Add custom chars to CGRAM
-    createCustomChars();
+    // Initialize LCD with slave address at the fastest rate it handles
+    LCD_init(lcd, EUSCI_B0_BASE, SLAVE_ADDRESS, LCD_I2C_PROBE);
 
-    while (1);
-}
+    // Register custom chars
+    LCD_setGlyphTable(lcd, glyphs, GLYPH_COUNT);
 
-/********************************/
-void createCustomChars(void)
-{
-    uint8_t happyFace[CHAR_HEIGHT] = { 0x00, 0x00, 0x0A, 0x00, 0x11, 0x0E, 0x00 };
-    uint8_t heart[CHAR_HEIGHT]     = { 0x00, 0x0A, 0x1F, 0x1F, 0x0E, 0x04, 0x00 };
-    uint8_t duck[CHAR_HEIGHT]      = { 0x00, 0x0C, 0x1D, 0x0F, 0x0F, 0x06, 0x00 };
+    // Register console commands, without them every line is text for the LCD
+    if(!CONSOLE_init(commands, sizeof(commands) / sizeof(commands[0]), COMMAND_SEED))
+    {
+        USB_sendString("console commands off, two names share a slot with COMMAND_SEED\r\n");
+    }
 
-    // Store happy face in memory address 0, heart in memory address 1....
-    LCD_createChar(HAPPYFACE_ADDR, happyFace);
-    LCD_createChar(HEART_ADDR, heart);
-    LCD_createChar(DUCK_ADDR, duck);
+    // Binary frames share the UART with the text console
+    PROTO_init(lcd);
 
-    // Creating custom char moves the cursor, we'll reset it
-    LCD_clear();
-    LCD_home();
+    while (1)
+    {
+        // Characters wait in the USB ring while the LCD is busy
+        uint8_t charReceived;
+        while(USB_readChar(&charReceived))
+        {
+            if(!PROTO_receiveChar(charReceived))
+            {
+                processChar(charReceived);
+            }
+        }
+
+        if(marqueeTick)
+        {
+            marqueeTick = false;
+            LCD_marqueeStep(lcd);
+        }
+
+        // Sleep until the next interrupt. With interrupts masked
+        // a character can't sneak in between the check and the sleep,
+        // a pending one still wakes us.
+        Interrupt_disableMaster();
+        if(USB_rxLevel() == 0 && !marqueeTick)
+        {
+            PCM_gotoLPM0();
+        }
+        Interrupt_enableMaster();
+    }
 }
 
 /********************************
- * Called every time a character is received from USB
- *
- * Test the i2c_lcd functions
+ * Called from the main loop for every character
+ * received from USB, collects lines for processLine
  *********************************/
-void usbCallbackFxn(uint8_t charReceived)
+void processChar(uint8_t charReceived)
 {
-    static char rxBuffer[32];
+    static char rxBuffer[LINE_LENGTH + 1];      // Room for the terminator
     static uint8_t rxPtr = 0;
 
     // Echo char received
     USB_sendBuffer(&charReceived, 1);
 
-    if(rxPtr == 32)
+    if(rxPtr == LINE_LENGTH)
     {
         rxPtr = 0;
     }
@@ -89,98 +206,345 @@ void usbCallbackFxn(uint8_t charReceived)
     {
         USB_sendBuffer("\n", 1);
 
-        if(strcmp(rxBuffer, "HAPPY") == 0)
-        {
-            LCD_writeChar(HAPPYFACE_ADDR);
-        }
-        else if(strcmp(rxBuffer, "HEART") == 0)
-        {
-            LCD_writeChar(HEART_ADDR);
-        }
-        else if(strcmp(rxBuffer, "DUCK") == 0)
-        {
-            LCD_writeChar(DUCK_ADDR);
-        }
-        else if(strcmp(rxBuffer, "HOME") == 0)
-        {
-            LCD_home();
-        }
-        else if(strcmp(rxBuffer, "CLEAR") == 0)
-        {
-            LCD_clear();
-        }
-        else if(strcmp(rxBuffer, "DISPLAYON") == 0)
-        {
-            LCD_displayOn();
-        }
-        else if(strcmp(rxBuffer, "DISPLAYOFF") == 0)
-        {
-            LCD_displayOff();
-        }
-        else if(strcmp(rxBuffer, "CURSORON") == 0)
-        {
-            LCD_cursorOn();
-        }
-        else if(strcmp(rxBuffer, "CURSOROFF") == 0)
-        {
-            LCD_cursorOff();
-        }
-        else if(strcmp(rxBuffer, "BLINKON") == 0)
-        {
-            LCD_blinkOn();
-        }
-        else if(strcmp(rxBuffer, "BLINKOFF") == 0)
-        {
-            LCD_blinkOff();
-        }
-        else if(strcmp(rxBuffer, "SHIFTLEFT") == 0)
-        {
-            LCD_shiftDisplayLeft();
-        }
-        else if(strcmp(rxBuffer, "SHIFTRIGHT") == 0)
-        {
-            LCD_shiftDisplayRight();
-        }
-        else if(strcmp(rxBuffer, "TEXTTORIGHT") == 0)
-        {
-            LCD_textLeftToRight();
-        }
-        else if(strcmp(rxBuffer, "TEXTTOLEFT") == 0)
-        {
-            LCD_textRightToLeft();
-        }
-        else if(strcmp(rxBuffer, "AUTOSCROLLON") == 0)
-        {
-            LCD_autoscrollOn();
-        }
-        else if(strcmp(rxBuffer, "AUTOSCROLLOFF") == 0)
-        {
-            LCD_autoscrollOff();
-        }
-        else if(strcmp(rxBuffer, "BACKLIGHTON") == 0)
-        {
-            LCD_backlightOn();
-        }
-        else if(strcmp(rxBuffer, "BACKLIGHTOFF") == 0)
-        {
-            LCD_backlightOff();
-        }
-        else
-        {
-            LCD_writeString((uint8_t*)rxBuffer, rxPtr);
-        }
+        processLine(rxBuffer, rxPtr);
 
         // Clear buffer
-        memset(rxBuffer, 0, 32);
+        memset(rxBuffer, 0, sizeof(rxBuffer));
         rxPtr = 0;
     }
     else if(charReceived == BACK_KEY)
     {
-        rxPtr--;
+        if(rxPtr > 0)
+        {
+            rxBuffer[--rxPtr] = 0;
+        }
     }
     else
     {
         rxBuffer[rxPtr++] = (char)charReceived;
     }
+}
+
+/********************************
+ * Test the i2c_lcd functions
+ * Lines that aren't a command go to the LCD
+ *********************************/
+void processLine(char * line, uint8_t length)
+{
+    int result = CONSOLE_dispatch(line);
+
+    if(result == CONSOLE_NOT_FOUND)
+    {
+        LCD_writeString(lcd, (uint8_t*)line, length);
+    }
+    else if(result == CONSOLE_BAD_ARGS)
+    {
+        USB_sendString("bad arguments\r\n");
+    }
+}
+
+/********************************
+ * Console commands
+ * Arguments are already counted against the table
+ *********************************/
+int commandHappy(uint8_t argc, char * argv[])
+{
+    return LCD_writeGlyph(lcd, HAPPYFACE_GLYPH);
+}
+
+int commandHeart(uint8_t argc, char * argv[])
+{
+    return LCD_writeGlyph(lcd, HEART_GLYPH);
+}
+
+int commandDuck(uint8_t argc, char * argv[])
+{
+    return LCD_writeGlyph(lcd, DUCK_GLYPH);
+}
+
+int commandHome(uint8_t argc, char * argv[])
+{
+    LCD_home(lcd);
+    return 1;
+}
+
+int commandClear(uint8_t argc, char * argv[])
+{
+    LCD_clear(lcd);
+    return 1;
+}
+
+int commandDisplayOn(uint8_t argc, char * argv[])
+{
+    LCD_displayOn(lcd);
+    return 1;
+}
+
+int commandDisplayOff(uint8_t argc, char * argv[])
+{
+    LCD_displayOff(lcd);
+    return 1;
+}
+
+int commandCursorOn(uint8_t argc, char * argv[])
+{
+    LCD_cursorOn(lcd);
+    return 1;
+}
+
+int commandCursorOff(uint8_t argc, char * argv[])
+{
+    LCD_cursorOff(lcd);
+    return 1;
+}
+
+int commandBlinkOn(uint8_t argc, char * argv[])
+{
+    LCD_blinkOn(lcd);
+    return 1;
+}
+
+int commandBlinkOff(uint8_t argc, char * argv[])
+{
+    LCD_blinkOff(lcd);
+    return 1;
+}
+
+int commandShiftLeft(uint8_t argc, char * argv[])
+{
+    LCD_shiftDisplayLeft(lcd);
+    return 1;
+}
+
+int commandShiftRight(uint8_t argc, char * argv[])
+{
+    LCD_shiftDisplayRight(lcd);
+    return 1;
+}
+
+int commandTextToRight(uint8_t argc, char * argv[])
+{
+    LCD_textLeftToRight(lcd);
+    return 1;
+}
+
+int commandTextToLeft(uint8_t argc, char * argv[])
+{
+    LCD_textRightToLeft(lcd);
+    return 1;
+}
+
+int commandAutoscrollOn(uint8_t argc, char * argv[])
+{
+    LCD_autoscrollOn(lcd);
+    return 1;
+}
+
+int commandAutoscrollOff(uint8_t argc, char * argv[])
+{
+    LCD_autoscrollOff(lcd);
+    return 1;
+}
+
+int commandBacklightOn(uint8_t argc, char * argv[])
+{
+    LCD_backlightOn(lcd);
+    return 1;
+}
+
+int commandBacklightOff(uint8_t argc, char * argv[])
+{
+    LCD_backlightOff(lcd);
+    return 1;
+}
+
+/********************************
+ * SETPOS row col
+ * Columns past the screen show once it is shifted
+ *********************************/
+int commandSetPos(uint8_t argc, char * argv[])
+{
+    uint8_t row, col;
+
+    if(!CONSOLE_parseNumber(argv[1], 10, LCD_ROWS - 1, &row) ||
+       !CONSOLE_parseNumber(argv[2], 10, LCD_LINE_LENGTH - 1, &col))
+    {
+        USB_sendString("row 0-");
+        USB_sendNumber(LCD_ROWS - 1);
+        USB_sendString(", col 0-");
+        USB_sendNumber(LCD_LINE_LENGTH - 1);
+        USB_sendString("\r\n");
+        return 0;
+    }
+
+    return LCD_setCursorPosition(lcd, row, col);
+}
+
+/********************************
+ * GLYPH id           draws a glyph from the table
+ * GLYPH slot rows... loads CHAR_HEIGHT hex rows into
+ *                    a CGRAM slot and draws it
+ *********************************/
+int commandGlyph(uint8_t argc, char * argv[])
+{
+    uint8_t id;
+
+    if(argc == 2)
+    {
+        return CONSOLE_parseNumber(argv[1], 10, GLYPH_COUNT - 1, &id) &&
+               LCD_writeGlyph(lcd, id);
+    }
+
+    if(argc != 2 + CHAR_HEIGHT || !CONSOLE_parseNumber(argv[1], 10, LCD_CGRAM_SLOTS - 1, &id))
+    {
+        return 0;
+    }
+
+    uint8_t charMap[CHAR_HEIGHT];
+    uint8_t row;
+    for(row = 0; row < CHAR_HEIGHT; row++)
+    {
+        if(!CONSOLE_parseNumber(argv[2 + row], 16, 0x1F, &charMap[row]))
+        {
+            return 0;
+        }
+    }
+
+    if(!LCD_createChar(lcd, id, charMap))
+    {
+        return 0;
+    }
+
+    LCD_writeChar(lcd, id);
+    return 1;
+}
+
+/********************************
+ * MARQUEE text scrolls text through the top row
+ * The rest of the line is the text, spaces and all
+ *********************************/
+int commandMarquee(uint8_t argc, char * argv[])
+{
+    // Tokenizing put terminators where the spaces were
+    char * end = argv[argc - 1] + strlen(argv[argc - 1]);
+    uint8_t length = end - argv[1];
+
+    uint8_t i;
+    for(i = 0; i < length; i++)
+    {
+        marqueeText[i] = argv[1][i] ? argv[1][i] : ' ';
+    }
+
+    if(!LCD_marqueeStart(lcd, 0, marqueeText, length))
+    {
+        return 0;
+    }
+
+    // Steps come from SysTick, the main loop does the LCD work
+    SysTick_setPeriod(CS_getMCLK() / MARQUEE_RATE);
+    SysTick_enableInterrupt();
+    SysTick_enableModule();
+    return 1;
+}
+
+int commandMarqueeOff(uint8_t argc, char * argv[])
+{
+    SysTick_disableModule();
+    LCD_marqueeStop(lcd, 0);
+    return 1;
+}
+
+int commandStats(uint8_t argc, char * argv[])
+{
+    printStats();
+    return 1;
+}
 
+#ifdef LCD_PROFILE
+int commandProfile(uint8_t argc, char * argv[])
+{
+    printProfile();
+    return 1;
+}
+#endif
+
+/********************************
+ * Print the LCD counters since the last STATS
+ *********************************/
+void printStats(void)
+{
+    LCD_Stats stats;
+    LCD_getStats(lcd, &stats);
+    LCD_resetStats(lcd);
+
+    USB_sendString("transactions ");
+    USB_sendNumber(stats.transactions);
+    USB_sendString("\r\nbytes ");
+    USB_sendNumber(stats.bytes);
+    USB_sendString("\r\nnacks ");
+    USB_sendNumber(stats.nacks);
+    USB_sendString("\r\ndelay us ");
+    USB_sendNumber(stats.delayUs);
+    USB_sendString("\r\ncommands ");
+    USB_sendNumber(stats.commands);
+    USB_sendString("\r\ndata ");
+    USB_sendNumber(stats.data);
+    USB_sendString("\r\nusb overruns ");
+    USB_sendNumber(USB_rxOverruns());
+    USB_sendString("\r\n");
+}
+
+#ifdef LCD_PROFILE
+/********************************
+ * Print latency in CPU cycles for every LCD call
+ * made since the last PROFILE, e.g.
+ * writeString n 12 max 52011 p50 32767 p99 65535 | 15:11 16:1
+ * After the bar: log2 bucket and calls that fell in it
+ *********************************/
+void printProfile(void)
+{
+    uint8_t id;
+    for(id = 0; id < LCD_PROFILE_COUNT; id++)
+    {
+        const LCD_Profile * profile = LCD_getProfile(id);
+        if(profile->count == 0)
+        {
+            continue;
+        }
+
+        USB_sendString(LCD_profileName(id));
+        USB_sendString(" n ");
+        USB_sendNumber(profile->count);
+        USB_sendString(" max ");
+        USB_sendNumber(profile->max);
+        USB_sendString(" p50 ");
+        USB_sendNumber(LCD_profilePercentile(profile, 50));
+        USB_sendString(" p99 ");
+        USB_sendNumber(LCD_profilePercentile(profile, 99));
+        USB_sendString(" |");
+
+        uint8_t bucket;
+        for(bucket = 0; bucket < LCD_PROFILE_BUCKETS; bucket++)
+        {
+            if(profile->buckets[bucket])
+            {
+                USB_sendString(" ");
+                USB_sendNumber(bucket);
+                USB_sendString(":");
+                USB_sendNumber(profile->buckets[bucket]);
+            }
+        }
+        USB_sendString("\r\n");
+    }
+
+    LCD_resetProfile();
+}
+#endif
+
+/********************************
+ * SysTick, time for the next marquee step
+ *********************************/
+void tickIntHandler(void)
+{
+    marqueeTick = true;
 }
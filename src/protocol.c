@@ -0,0 +1,242 @@
+/*
+ * protocol.c
+ *
+ *  Device side of the binary framed protocol, see protocol.h
+ *  Fed one received character at a time from the main loop.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "protocol.h"
+#include "usb.h"
+
+/***************************
+ * File Specific Defines
+ ***************************/
+#define STATE_SYNC              0       // Waiting for PROTO_SYNC
+#define STATE_LENGTH            1
+#define STATE_BODY              2       // SEQ, OP and payload
+#define STATE_CRC_LOW           3
+#define STATE_CRC_HIGH          4
+
+#define CRC_INIT                0xFFFF
+#define CRC_POLY                0x1021
+
+// Bytes a host may have unacknowledged, what the USB RX ring holds
+#define PROTO_WINDOW            127
+
+/***************************
+ * File Specific Functions
+ ***************************/
+static uint16_t _crcUpdate(uint16_t crc, uint8_t data);
+static uint8_t _execute(uint8_t op, uint8_t * payload, uint8_t length);
+static void _sendAck(uint8_t seq, uint8_t status);
+
+/***************************
+ * Global Variables
+ ***************************/
+static LCD_Handle _lcd;
+
+static uint8_t _state = STATE_SYNC;
+static uint8_t _body[2 + PROTO_MAX_PAYLOAD];    // SEQ, OP, payload
+static uint8_t _length;                         // LEN of the frame coming in
+static uint8_t _index;                          // Body bytes so far
+static uint16_t _crc;                           // Running CRC
+static uint16_t _crcReceived;
+
+/***************************/
+void PROTO_init(LCD_Handle lcd)
+{
+    _lcd = lcd;
+    _state = STATE_SYNC;
+}
+
+/***************************
+ * Run a received character through the frame parser
+ * Returns: true if it was part of a frame, false if
+ *          it belongs to the text console
+ ***************************/
+bool PROTO_receiveChar(uint8_t charReceived)
+{
+    switch(_state)
+    {
+    case STATE_SYNC:
+        if(charReceived != PROTO_SYNC)
+        {
+            return false;
+        }
+        _state = STATE_LENGTH;
+        break;
+
+    case STATE_LENGTH:
+        // Needs at least an opcode, too long can't be ours
+        if(charReceived == 0 || charReceived > PROTO_MAX_PAYLOAD + 1)
+        {
+            _state = STATE_SYNC;
+            break;
+        }
+        _length = charReceived;
+        _index = 0;
+        _crc = _crcUpdate(CRC_INIT, charReceived);
+        _state = STATE_BODY;
+        break;
+
+    case STATE_BODY:
+        _body[_index++] = charReceived;
+        _crc = _crcUpdate(_crc, charReceived);
+        if(_index == _length + 1)
+        {
+            _state = STATE_CRC_LOW;
+        }
+        break;
+
+    case STATE_CRC_LOW:
+        _crcReceived = charReceived;
+        _state = STATE_CRC_HIGH;
+        break;
+
+    case STATE_CRC_HIGH:
+        _crcReceived |= (uint16_t)charReceived << 8;
+        _state = STATE_SYNC;
+
+        if(_crcReceived != _crc)
+        {
+            _sendAck(_body[0], PROTO_BAD_CRC);
+        }
+        else
+        {
+            _sendAck(_body[0], _execute(_body[1], &_body[2], _length - 1));
+        }
+        break;
+    }
+
+    return true;
+}
+
+/***************************
+ * Carry out one frame
+ * Returns: PROTO_* status for the ACK
+ ***************************/
+static uint8_t _execute(uint8_t op, uint8_t * payload, uint8_t length)
+{
+    // Control opcodes all take a single on/off style byte
+    if(op >= PROTO_OP_DISPLAY && op <= PROTO_OP_BACKLIGHT && length != 1)
+    {
+        return PROTO_BAD_ARGS;
+    }
+
+    bool on = (length > 0) && payload[0];
+
+    switch(op)
+    {
+    case PROTO_OP_WRITE_AT:
+        if(length < 2 || !LCD_setCursorPosition(_lcd, payload[0], payload[1]))
+        {
+            return PROTO_BAD_ARGS;
+        }
+        LCD_writeRaw(_lcd, &payload[2], length - 2);
+        break;
+
+    case PROTO_OP_BLIT:
+        if(length != LCD_ROWS * LCD_COLUMNS)
+        {
+            return PROTO_BAD_ARGS;
+        }
+        LCD_setCursorPosition(_lcd, 0, 0);
+        LCD_writeRaw(_lcd, payload, LCD_COLUMNS);
+        LCD_setCursorPosition(_lcd, 1, 0);
+        LCD_writeRaw(_lcd, &payload[LCD_COLUMNS], LCD_COLUMNS);
+        break;
+
+    case PROTO_OP_GLYPH:
+        if(length != 1 + CHAR_HEIGHT)
+        {
+            return PROTO_BAD_ARGS;
+        }
+        if(!LCD_createChar(_lcd, payload[0], &payload[1]))
+        {
+            return PROTO_FAILED;
+        }
+        break;
+
+    case PROTO_OP_CLEAR:
+        LCD_clear(_lcd);
+        break;
+
+    case PROTO_OP_HOME:
+        LCD_home(_lcd);
+        break;
+
+    case PROTO_OP_DISPLAY:
+        on ? LCD_displayOn(_lcd) : LCD_displayOff(_lcd);
+        break;
+
+    case PROTO_OP_CURSOR:
+        on ? LCD_cursorOn(_lcd) : LCD_cursorOff(_lcd);
+        break;
+
+    case PROTO_OP_BLINK:
+        on ? LCD_blinkOn(_lcd) : LCD_blinkOff(_lcd);
+        break;
+
+    case PROTO_OP_SHIFT:
+        on ? LCD_shiftDisplayRight(_lcd) : LCD_shiftDisplayLeft(_lcd);
+        break;
+
+    case PROTO_OP_DIRECTION:
+        on ? LCD_textLeftToRight(_lcd) : LCD_textRightToLeft(_lcd);
+        break;
+
+    case PROTO_OP_AUTOSCROLL:
+        on ? LCD_autoscrollOn(_lcd) : LCD_autoscrollOff(_lcd);
+        break;
+
+    case PROTO_OP_BACKLIGHT:
+        on ? LCD_backlightOn(_lcd) : LCD_backlightOff(_lcd);
+        break;
+
+    case PROTO_OP_HELLO:
+        break;
+
+    default:
+        return PROTO_BAD_OPCODE;
+    }
+
+    return PROTO_OK;
+}
+
+/***************************
+ * ACK goes out after the frame has been carried out
+ * so the host is paced by the display
+ ***************************/
+static void _sendAck(uint8_t seq, uint8_t status)
+{
+    uint8_t frame[PROTO_OVERHEAD + 2] = { PROTO_SYNC, 3, seq, PROTO_OP_ACK, status, PROTO_WINDOW };
+
+    uint16_t crc = CRC_INIT;
+    uint8_t i;
+    for(i = 1; i < PROTO_OVERHEAD; i++)
+    {
+        crc = _crcUpdate(crc, frame[i]);
+    }
+    frame[6] = crc & 0xFF;
+    frame[7] = crc >> 8;
+
+    USB_sendBuffer(frame, sizeof(frame));
+}
+
+/***************************
+ * CRC-16/CCITT, one byte at a time
+ ***************************/
+static uint16_t _crcUpdate(uint16_t crc, uint8_t data)
+{
+    crc ^= (uint16_t)data << 8;
+
+    uint8_t bit;
+    for(bit = 0; bit < 8; bit++)
+    {
+        crc = (crc & 0x8000) ? (crc << 1) ^ CRC_POLY : crc << 1;
+    }
+
+    return crc;
+}
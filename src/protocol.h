@@ -0,0 +1,60 @@
+/*
+ * protocol.h
+ *
+ *  Binary framed protocol for driving the LCD over the USB UART
+ *
+ *  Frame: SYNC LEN SEQ OP PAYLOAD[LEN - 1] CRC_LO CRC_HI
+ *
+ *  LEN counts OP and the payload. CRC is CRC-16/CCITT
+ *  (poly 0x1021, init 0xFFFF) over LEN, SEQ, OP and the payload.
+ *
+ *  Every frame is answered with an ACK frame once it has been
+ *  carried out: payload is status then window. A host may have
+ *  at most window bytes sent and not yet acknowledged, so the
+ *  device's receive buffer never overflows and the host is paced
+ *  to what the display can take. Send HELLO first to learn it.
+ *
+ *  The text console keeps working, SYNC is never typed.
+ */
+
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PROTO_SYNC              0xA5
+#define PROTO_MAX_PAYLOAD       40      // Fits a full screen blit
+#define PROTO_OVERHEAD          6       // SYNC, LEN, SEQ, OP and CRC
+
+// Opcodes, payload in brackets
+#define PROTO_OP_WRITE_AT       0x01    // [row, col, chars...]
+#define PROTO_OP_BLIT           0x02    // [LCD_ROWS * LCD_COLUMNS chars]
+#define PROTO_OP_GLYPH          0x03    // [slot 0-7, CHAR_HEIGHT rows]
+#define PROTO_OP_CLEAR          0x10    // []
+#define PROTO_OP_HOME           0x11    // []
+#define PROTO_OP_DISPLAY        0x12    // [0 off, 1 on]
+#define PROTO_OP_CURSOR         0x13    // [0 off, 1 on]
+#define PROTO_OP_BLINK          0x14    // [0 off, 1 on]
+#define PROTO_OP_SHIFT          0x15    // [0 left, 1 right]
+#define PROTO_OP_DIRECTION      0x16    // [0 right to left, 1 left to right]
+#define PROTO_OP_AUTOSCROLL     0x17    // [0 off, 1 on]
+#define PROTO_OP_BACKLIGHT      0x18    // [0 off, 1 on]
+#define PROTO_OP_HELLO          0x20    // []
+#define PROTO_OP_ACK            0x80    // [status, window] device to host only
+
+// ACK status
+#define PROTO_OK                0x00
+#define PROTO_BAD_CRC           0x01
+#define PROTO_BAD_OPCODE        0x02
+#define PROTO_BAD_ARGS          0x03
+#define PROTO_FAILED            0x04    // LCD call returned an error
+
+#ifndef PROTO_HOST
+#include "i2c_lcd.h"
+
+void PROTO_init(LCD_Handle lcd);
+bool PROTO_receiveChar(uint8_t charReceived);
+#endif
+
+#endif /* PROTOCOL_H_ */
@@ -5,6 +5,9 @@
  *      Author: hhedg
  */
 
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
 #include <driverlib.h>
 #include "usb.h"
 
@@ -16,18 +19,42 @@
 #define USB_UART_BASE           EUSCI_A0_BASE
 #define RX_INTERRUPT            EUSCI_A_UART_RECEIVE_INTERRUPT
 #define TX_INTERRUPT            EUSCI_A_UART_TRANSMIT_INTERRUPT
+#define RX_INTERRUPT_FLAG       EUSCI_A_UART_RECEIVE_INTERRUPT_FLAG
+#define TX_INTERRUPT_FLAG       EUSCI_A_UART_TRANSMIT_INTERRUPT_FLAG
 #define USB_UART_INT            INT_EUSCIA0
 
 /***************************
- * UART Configuration based on TI Tool:
+ * Transmit ring buffer
+ *
+ * Writers copy into the ring and return, the TX interrupt
+ * moves one byte into TXBUF each time it empties and turns
+ * itself off when the ring runs dry.
+ ***************************/
+#define TX_BUFFER_SIZE          256     // Must be a power of 2
+#define TX_BUFFER_MASK          (TX_BUFFER_SIZE - 1)
+
+/***************************
+ * Receive ring buffer
+ *
+ * The RX interrupt only stores the byte, the main loop
+ * reads it with USB_readChar. One producer, one consumer,
+ * so no locking: each index is moved by one side only.
+ ***************************/
+#define RX_BUFFER_SIZE          128     // Must be a power of 2
+#define RX_BUFFER_MASK          (RX_BUFFER_SIZE - 1)
+
+/***************************
+ * UART Configuration
+ * Divider and modulation are filled in by _setBaudRate()
+ * the same way as TI's tool:
  * http://software-dl.ti.com/msp430/msp430_public_sw/mcu/msp430/MSP430BaudRateConverter/index.html
  ***************************/
-const eUSCI_UART_Config usbUARTConfig =
+static eUSCI_UART_Config usbUARTConfig =
 {
     EUSCI_A_UART_CLOCKSOURCE_SMCLK,                 // SMCLK Clock Source
-    19,                                             // BRDIV = 19
-    8,                                              // UCxBRF = 8
-    85,                                             // UCxBRS = 85
+    19,                                             // BRDIV, 9600 baud at 3MHz
+    8,                                              // UCxBRF
+    85,                                             // UCxBRS
     EUSCI_A_UART_NO_PARITY,                         // No Parity
     EUSCI_A_UART_LSB_FIRST,                         // MSB First
     EUSCI_A_UART_ONE_STOP_BIT,                      // One stop bit
@@ -35,54 +62,341 @@ const eUSCI_UART_Config usbUARTConfig =
     EUSCI_A_UART_OVERSAMPLING_BAUDRATE_GENERATION   // Over sampling
 };
 
+static uint32_t _baudRate;
+
+/***************************
+ * UCBRSx for the fractional part of SMCLK / baud, in
+ * 1/10000ths (user's guide SLAU356, table 24-4).
+ * Use the last entry not above the fraction.
+ ***************************/
+#define FRACTION_SCALE          10000
+#define MIN_OVERSAMPLING_N      16      // Below this, low frequency mode
+
+static const uint16_t _fractions[] =
+{
+       0,  529,  715,  835, 1001, 1252, 1430, 1670, 2147, 2224, 2503, 3000,
+    3335, 3575, 3753, 4003, 4286, 4378, 5002, 5715, 6003, 6254, 6432, 6667,
+    7001, 7147, 7503, 7861, 8004, 8333, 8464, 8572, 8751, 9004, 9170, 9288
+};
+
+static const uint8_t _modulations[] =
+{
+    0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x11, 0x21, 0x22, 0x44, 0x25,
+    0x49, 0x4A, 0x52, 0x92, 0x53, 0x55, 0xAA, 0x6B, 0xAD, 0xB5, 0xB6, 0xD6,
+    0xB7, 0xBB, 0xDD, 0xED, 0xEE, 0xBF, 0xDF, 0xEF, 0xF7, 0xFB, 0xFD, 0xFE
+};
+
+// Writers can be main and interrupts, they take turns with interrupts off
+static uint8_t _txBuffer[TX_BUFFER_SIZE];
+static volatile uint16_t _txHead;       // Next free byte, only moved by writers
+static volatile uint16_t _txTail;       // Next byte to send, only moved by _txService
+
+static uint8_t _rxBuffer[RX_BUFFER_SIZE];
+static volatile uint16_t _rxHead;       // Next free byte, only moved by USB_intHandler
+static volatile uint16_t _rxTail;       // Next byte to read, only moved by USB_readChar
+static volatile uint32_t _rxOverruns;   // Bytes dropped because the ring was full
+
 /***************************
- * Function to be called on receiving character from USB
+ * File Specific Functions
  ***************************/
-void (*_usbCallbackFxn)(uint8_t charReceived);
+static void _txService(void);
+static void _txQueue(const uint8_t * buffer, uint16_t length);
+static int _setBaudRate(uint32_t baudRate);
+static void _uartStart(void);
 
 /***************************
  * Setup USB UART
+ * Param: baud rate, up to 921600 with a fast enough SMCLK
+ * Returns: 1 on success, 0 if SMCLK can't make that rate
  ***************************/
-void USB_init(void (*usbCallbackFxn)(uint8_t charReceived))
+int USB_init(uint32_t baudRate)
 {
+    if(!_setBaudRate(baudRate))
+    {
+        return 0;
+    }
+
     GPIO_setAsPeripheralModuleFunctionInputPin(USB_UART_PINS, PRIMARY_FUNCTION);
 
+    _uartStart();
+
+    Interrupt_enableInterrupt(USB_UART_INT);
+
+    return 1;
+}
+
+/***************************
+ * Call after changing SMCLK to keep the same baud rate
+ * Waits for queued output to go out first
+ * Returns: 1 on success, 0 if SMCLK can't make the rate
+ ***************************/
+int USB_clockChanged(void)
+{
+    while(USB_txLevel() != 0 || UART_queryStatusFlags(USB_UART_BASE, EUSCI_A_UART_BUSY));
+
+    if(!_setBaudRate(_baudRate))
+    {
+        return 0;
+    }
+
+    _uartStart();
+
+    return 1;
+}
+
+/***************************
+ * N = SMCLK / baud
+ * N >= 16: UCBRx = N / 16, UCBRFx = N % 16 (16x oversampling)
+ * N < 16:  UCBRx = N
+ * and UCBRSx from the fraction of N in both cases
+ ***************************/
+static int _setBaudRate(uint32_t baudRate)
+{
+    uint32_t clock = CS_getSMCLK();
+
+    if(baudRate == 0 || clock / baudRate == 0)
+    {
+        return 0;
+    }
+
+    uint32_t n = clock / baudRate;
+    uint32_t fraction = ((uint64_t)(clock % baudRate) * FRACTION_SCALE) / baudRate;
+
+    uint8_t i = 0;
+    while(i < sizeof(_fractions) / sizeof(_fractions[0]) - 1 && _fractions[i + 1] <= fraction)
+    {
+        i++;
+    }
+    usbUARTConfig.secondModReg = _modulations[i];
+
+    if(n >= MIN_OVERSAMPLING_N)
+    {
+        usbUARTConfig.clockPrescalar = n / 16;
+        usbUARTConfig.firstModReg = n % 16;
+        usbUARTConfig.overSampling = EUSCI_A_UART_OVERSAMPLING_BAUDRATE_GENERATION;
+    }
+    else
+    {
+        usbUARTConfig.clockPrescalar = n;
+        usbUARTConfig.firstModReg = 0;
+        usbUARTConfig.overSampling = EUSCI_A_UART_LOW_FREQUENCY_BAUDRATE_GENERATION;
+    }
+
+    _baudRate = baudRate;
+
+    return 1;
+}
+
+/***************************
+ * (Re)initializing the module clears its interrupt
+ * enables, turn RX back on
+ ***************************/
+static void _uartStart(void)
+{
     UART_initModule(USB_UART_BASE, &usbUARTConfig);
 
     UART_enableModule(USB_UART_BASE);
 
     UART_enableInterrupt(USB_UART_BASE, RX_INTERRUPT);
 
-    Interrupt_enableInterrupt(USB_UART_INT);
-
-    _usbCallbackFxn = usbCallbackFxn;
+    if(USB_txLevel() != 0)
+    {
+        UART_enableInterrupt(USB_UART_BASE, TX_INTERRUPT);
+    }
 }
 
 /***************************
  * Triggered on all EUSCI_A0 UART interrupts
- * Call callbackFxn when character is received
- * No echo
+ * Received characters go in the RX ring, no echo
  ***************************/
 void USB_intHandler(void)
 {
     uint32_t intStatus = UART_getEnabledInterruptStatus(USB_UART_BASE);
 
-    if(intStatus == RX_INTERRUPT)
+    if(intStatus & TX_INTERRUPT_FLAG)
+    {
+        _txService();
+    }
+
+    if(intStatus & RX_INTERRUPT_FLAG)
     {
         UART_clearInterruptFlag(USB_UART_BASE, RX_INTERRUPT);
 
         uint8_t charReceived = UART_receiveData(USB_UART_BASE);
 
-        _usbCallbackFxn(charReceived);
+        uint16_t next = (_rxHead + 1) & RX_BUFFER_MASK;
+        if(next == _rxTail)
+        {
+            _rxOverruns++;
+        }
+        else
+        {
+            _rxBuffer[_rxHead] = charReceived;
+            _rxHead = next;
+        }
     }
 }
 
-/***************************/
+/***************************
+ * Take the oldest received character
+ * Returns: true if there was one
+ ***************************/
+bool USB_readChar(uint8_t * charReceived)
+{
+    if(_rxTail == _rxHead)
+    {
+        return false;
+    }
+
+    *charReceived = _rxBuffer[_rxTail];
+    _rxTail = (_rxTail + 1) & RX_BUFFER_MASK;
+
+    return true;
+}
+
+/***************************
+ * Returns: characters waiting to be read
+ ***************************/
+uint16_t USB_rxLevel(void)
+{
+    return (_rxHead - _rxTail) & RX_BUFFER_MASK;
+}
+
+/***************************
+ * Returns: characters lost to a full RX ring
+ ***************************/
+uint32_t USB_rxOverruns(void)
+{
+    return _rxOverruns;
+}
+
+/***************************
+ * Queue bytes for sending and return
+ * Only waits if the ring is full
+ ***************************/
 void USB_sendBuffer(uint8_t* buffer, uint8_t bufferSize)
 {
-    int i;
-    for(i = 0; i < bufferSize; i++)
+    _txQueue(buffer, bufferSize);
+}
+
+/***************************
+ * Queue as many bytes as fit right now, never waits
+ * Interrupt_disableMaster returns true if interrupts were
+ * off already, callers that masked them keep them masked
+ * Returns: number of bytes taken
+ ***************************/
+uint16_t USB_write(const uint8_t * buffer, uint16_t length)
+{
+    bool intsDisabled = Interrupt_disableMaster();
+
+    uint16_t free = (_txTail - _txHead - 1) & TX_BUFFER_MASK;
+    if(length > free)
+    {
+        length = free;
+    }
+
+    uint16_t i;
+    for(i = 0; i < length; i++)
+    {
+        _txBuffer[(_txHead + i) & TX_BUFFER_MASK] = buffer[i];
+    }
+    _txHead = (_txHead + length) & TX_BUFFER_MASK;
+
+    if(length)
     {
-        UART_transmitData(USB_UART_BASE, buffer[i]);
+        UART_enableInterrupt(USB_UART_BASE, TX_INTERRUPT);
     }
+
+    if(!intsDisabled)
+    {
+        Interrupt_enableMaster();
+    }
+
+    return length;
+}
+
+/***************************
+ * Returns: bytes still waiting to go out
+ ***************************/
+uint16_t USB_txLevel(void)
+{
+    return (_txHead - _txTail) & TX_BUFFER_MASK;
+}
+
+/***************************
+ * Everything goes through the ring. When it's full we
+ * move bytes ourselves in case the TX interrupt is
+ * held off (called with interrupts masked or from a
+ * higher priority interrupt).
+ ***************************/
+static void _txQueue(const uint8_t * buffer, uint16_t length)
+{
+    while(length)
+    {
+        uint16_t taken = USB_write(buffer, length);
+        buffer += taken;
+        length -= taken;
+
+        if(length)
+        {
+            bool intsDisabled = Interrupt_disableMaster();
+
+            if(UART_getInterruptStatus(USB_UART_BASE, TX_INTERRUPT_FLAG))
+            {
+                _txService();
+            }
+
+            if(!intsDisabled)
+            {
+                Interrupt_enableMaster();
+            }
+        }
+    }
+}
+
+/***************************
+ * TXBUF is empty: send the next byte or stop the interrupt
+ ***************************/
+static void _txService(void)
+{
+    if(_txTail == _txHead)
+    {
+        UART_disableInterrupt(USB_UART_BASE, TX_INTERRUPT);
+        return;
+    }
+
+    UART_transmitData(USB_UART_BASE, _txBuffer[_txTail]);
+    _txTail = (_txTail + 1) & TX_BUFFER_MASK;
+}
+
+/***************************
+ * Send a null terminated string
+ ***************************/
+void USB_sendString(const char * string)
+{
+    _txQueue((const uint8_t *)string, strlen(string));
+}
+
+/***************************
+ * Send an unsigned number in decimal
+ ***************************/
+void USB_sendNumber(uint32_t value)
+{
+    uint8_t digits[10];
+    uint8_t count = 0;
+
+    do
+    {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while(value);
+
+    uint8_t text[10];
+    uint8_t length = 0;
+    while(count)
+    {
+        text[length++] = digits[--count];
+    }
+
+    _txQueue(text, length);
 }
@@ -8,8 +8,16 @@
 #ifndef USB_H_
 #define USB_H_
 
-void USB_init(void (*usbCallbackFxn)(uint8_t charReceived));
+int USB_init(uint32_t baudRate);
+int USB_clockChanged(void);
 void USB_intHandler(void);
+bool USB_readChar(uint8_t * charReceived);
+uint16_t USB_rxLevel(void);
+uint32_t USB_rxOverruns(void);
 void USB_sendBuffer(uint8_t* bufferToSend, uint8_t numChars);
+void USB_sendString(const char * string);
+void USB_sendNumber(uint32_t value);
+uint16_t USB_write(const uint8_t * buffer, uint16_t length);
+uint16_t USB_txLevel(void);
 
 #endif /* USB_H_ */
@@ -57,6 +57,20 @@ extern unsigned long __STACK_END;
 /* External declarations for the interrupt handlers used by the application. */
 /* EUSCIA0_IRQHandler */
 extern void USB_intHandler(void);
+/* EUSCIB0_IRQHandler */
+extern void LCD_i2cB0IntHandler(void);
+/* EUSCIB1_IRQHandler */
+extern void LCD_i2cB1IntHandler(void);
+/* DMA_INT1_IRQHandler */
+extern void LCD_dmaB0IntHandler(void);
+/* DMA_INT2_IRQHandler */
+extern void LCD_dmaB1IntHandler(void);
+/* T32_INT2_IRQHandler */
+extern void LCD_timerIntHandler(void);
+/* TA0_0_IRQHandler */
+extern void LCD_refreshIntHandler(void);
+/* SysTick_Handler */
+extern void tickIntHandler(void);
 
 /* Interrupt vector table.  Note that the proper constructs must be placed on this to  */
 /* ensure that it ends up at physical address 0x0000.0000 or at the start of          */
@@ -81,7 +95,7 @@ void (* const interruptVectors[])(void) =
     defaultISR,                             /* Debug monitor handler     */
     0,                                      /* Reserved                  */
     defaultISR,                             /* The PendSV handler        */
-    defaultISR,                             /* The SysTick handler       */
+    tickIntHandler,                         /* The SysTick handler       */
     defaultISR,                             /* PSS ISR                   */
     defaultISR,                             /* CS ISR                    */
     defaultISR,                             /* PCM ISR                   */
@@ -90,7 +104,7 @@ void (* const interruptVectors[])(void) =
     defaultISR,                             /* FLCTL ISR                 */
     defaultISR,                             /* COMP0 ISR                 */
     defaultISR,                             /* COMP1 ISR                 */
-    defaultISR,                             /* TA0_0 ISR                 */
+    LCD_refreshIntHandler,                  /* TA0_0 ISR                 */
     defaultISR,                             /* TA0_N ISR                 */
     defaultISR,                             /* TA1_0 ISR                 */
     defaultISR,                             /* TA1_N ISR                 */
@@ -102,20 +116,20 @@ void (* const interruptVectors[])(void) =
     defaultISR,                             /* EUSCIA1 ISR               */
     defaultISR,                             /* EUSCIA2 ISR               */
     defaultISR,                             /* EUSCIA3 ISR               */
-    defaultISR,                             /* EUSCIB0 ISR               */
-    defaultISR,                             /* EUSCIB1 ISR               */
+    LCD_i2cB0IntHandler,                    /* EUSCIB0 ISR               */
+    LCD_i2cB1IntHandler,                    /* EUSCIB1 ISR               */
     defaultISR,                             /* EUSCIB2 ISR               */
     defaultISR,                             /* EUSCIB3 ISR               */
     defaultISR,                             /* ADC14 ISR                 */
     defaultISR,                             /* T32_INT1 ISR              */
-    defaultISR,                             /* T32_INT2 ISR              */
+    LCD_timerIntHandler,                    /* T32_INT2 ISR              */
     defaultISR,                             /* T32_INTC ISR              */
     defaultISR,                             /* AES ISR                   */
     defaultISR,                             /* RTC ISR                   */
     defaultISR,                             /* DMA_ERR ISR               */
     defaultISR,                             /* DMA_INT3 ISR              */
-    defaultISR,                             /* DMA_INT2 ISR              */
-    defaultISR,                             /* DMA_INT1 ISR              */
+    LCD_dmaB1IntHandler,                    /* DMA_INT2 ISR              */
+    LCD_dmaB0IntHandler,                    /* DMA_INT1 ISR              */
     defaultISR,                             /* DMA_INT0 ISR              */
     defaultISR,                             /* PORT1 ISR                 */
     defaultISR,                             /* PORT2 ISR                 */